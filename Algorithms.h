@@ -0,0 +1,525 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Sums and searches over double and 64/32-bit integers use AVX-512 or AVX2
+// when the compiler targets them. Defining LINEAR_ALGORITHMS_SCALAR selects
+// the portable loops, which compilers can still vectorize on their own.
+#if defined(LINEAR_ALGORITHMS_SCALAR)
+#elif defined(__AVX512F__)
+#define LINEAR_ALGORITHMS_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define LINEAR_ALGORITHMS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace Linear
+{
+
+// Bulk operations over contiguous containers (Vector, SmallVector, or
+// anything else with data() and getSize()). They work on the raw storage, so
+// no per-element iterator checks are paid. Every operation has an overload
+// taking Parallel first, which splits the storage into one chunk per thread.
+namespace Algorithms
+{
+
+struct Parallel
+{
+  unsigned threads;//0 uses std::thread::hardware_concurrency()
+
+  explicit Parallel(unsigned threads=0) : threads(threads)
+  {}
+};
+
+namespace Detail
+{
+
+// Ranges shorter than this per thread are not worth a thread of their own.
+constexpr std::size_t MIN_CHUNK = 1<<14;
+// Parallel searches look at the other threads' results this often.
+constexpr std::size_t SEARCH_BLOCK = 1<<10;
+
+template <typename Type, typename BinaryOp>
+struct IsSum : std::integral_constant<bool, std::is_same<BinaryOp, std::plus<Type>>::value ||
+                                            std::is_same<BinaryOp, std::plus<>>::value>
+{};
+
+template <typename Type>
+struct HasSimdSum : std::integral_constant<bool, std::is_same<Type, double>::value ||
+                                                 std::is_same<Type, std::int64_t>::value>
+{};
+
+template <typename Type>
+struct HasSimdFind : std::integral_constant<bool, std::is_same<Type, double>::value ||
+                                                  std::is_same<Type, std::int64_t>::value ||
+                                                  std::is_same<Type, std::int32_t>::value>
+{};
+
+inline std::size_t lowestBit(unsigned mask)
+{
+#if defined(__GNUC__)
+  return __builtin_ctz(mask);
+#else
+  std::size_t bit=0;
+  while ((mask&1)==0)
+  {
+    mask>>=1;
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+// Sums with several independent accumulators, so the additions do not
+// wait on each other. The order of the additions differs from a plain loop.
+inline double simdSum(const double* first, std::size_t n)
+{
+  std::size_t i=0;
+  double total=0;
+#if defined(LINEAR_ALGORITHMS_AVX512)
+  __m512d a0=_mm512_setzero_pd();
+  __m512d a1=_mm512_setzero_pd();
+  for (;i+16<=n;i+=16)
+  {
+    a0=_mm512_add_pd(a0, _mm512_loadu_pd(first+i));
+    a1=_mm512_add_pd(a1, _mm512_loadu_pd(first+i+8));
+  }
+  // Stored rather than _mm512_reduce_add_pd, which trips GCC 12's
+  // -Wuninitialized inside its own header.
+  double lanes[8];
+  _mm512_storeu_pd(lanes, _mm512_add_pd(a0, a1));
+  total=((lanes[0]+lanes[1])+(lanes[2]+lanes[3]))+((lanes[4]+lanes[5])+(lanes[6]+lanes[7]));
+#elif defined(LINEAR_ALGORITHMS_AVX2)
+  __m256d a0=_mm256_setzero_pd();
+  __m256d a1=_mm256_setzero_pd();
+  for (;i+8<=n;i+=8)
+  {
+    a0=_mm256_add_pd(a0, _mm256_loadu_pd(first+i));
+    a1=_mm256_add_pd(a1, _mm256_loadu_pd(first+i+4));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(a0, a1));
+  total=(lanes[0]+lanes[1])+(lanes[2]+lanes[3]);
+#else
+  double a[4]={0, 0, 0, 0};
+  for (;i+4<=n;i+=4)
+    for (std::size_t lane=0;lane<4;lane++)
+      a[lane]+=first[i+lane];
+  total=(a[0]+a[1])+(a[2]+a[3]);
+#endif
+  for (;i<n;i++)
+    total+=first[i];
+  return total;
+}
+
+// Integer sums wrap around on overflow instead of being undefined.
+inline std::int64_t simdSum(const std::int64_t* first, std::size_t n)
+{
+  std::size_t i=0;
+  std::uint64_t total=0;
+#if defined(LINEAR_ALGORITHMS_AVX512)
+  __m512i a0=_mm512_setzero_si512();
+  __m512i a1=_mm512_setzero_si512();
+  for (;i+16<=n;i+=16)
+  {
+    a0=_mm512_add_epi64(a0, _mm512_loadu_si512(first+i));
+    a1=_mm512_add_epi64(a1, _mm512_loadu_si512(first+i+8));
+  }
+  std::uint64_t lanes[8];
+  _mm512_storeu_si512(lanes, _mm512_add_epi64(a0, a1));
+  for (std::size_t lane=0;lane<8;lane++)
+    total+=lanes[lane];
+#elif defined(LINEAR_ALGORITHMS_AVX2)
+  __m256i a0=_mm256_setzero_si256();
+  __m256i a1=_mm256_setzero_si256();
+  for (;i+8<=n;i+=8)
+  {
+    a0=_mm256_add_epi64(a0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first+i)));
+    a1=_mm256_add_epi64(a1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first+i+4)));
+  }
+  std::uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(a0, a1));
+  total=lanes[0]+lanes[1]+lanes[2]+lanes[3];
+#endif
+  for (;i<n;i++)
+    total+=static_cast<std::uint64_t>(first[i]);
+  return static_cast<std::int64_t>(total);
+}
+
+// Returns the index of the first element equal to value, or n.
+inline std::size_t simdFind(const double* first, std::size_t n, double value)
+{
+  std::size_t i=0;
+#if defined(LINEAR_ALGORITHMS_AVX512)
+  __m512d needle=_mm512_set1_pd(value);
+  for (;i+8<=n;i+=8)
+  {
+    unsigned mask=_mm512_cmp_pd_mask(_mm512_loadu_pd(first+i), needle, _CMP_EQ_OQ);
+    if (mask!=0)
+      return i+lowestBit(mask);
+  }
+#elif defined(LINEAR_ALGORITHMS_AVX2)
+  __m256d needle=_mm256_set1_pd(value);
+  for (;i+4<=n;i+=4)
+  {
+    unsigned mask=_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(first+i), needle, _CMP_EQ_OQ));
+    if (mask!=0)
+      return i+lowestBit(mask);
+  }
+#endif
+  for (;i<n;i++)
+    if (first[i]==value)
+      return i;
+  return n;
+}
+
+inline std::size_t simdFind(const std::int64_t* first, std::size_t n, std::int64_t value)
+{
+  std::size_t i=0;
+#if defined(LINEAR_ALGORITHMS_AVX512)
+  __m512i needle=_mm512_set1_epi64(value);
+  for (;i+8<=n;i+=8)
+  {
+    unsigned mask=_mm512_cmpeq_epi64_mask(_mm512_loadu_si512(first+i), needle);
+    if (mask!=0)
+      return i+lowestBit(mask);
+  }
+#elif defined(LINEAR_ALGORITHMS_AVX2)
+  __m256i needle=_mm256_set1_epi64x(value);
+  for (;i+4<=n;i+=4)
+  {
+    __m256i equal=_mm256_cmpeq_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first+i)), needle);
+    unsigned mask=_mm256_movemask_pd(_mm256_castsi256_pd(equal));
+    if (mask!=0)
+      return i+lowestBit(mask);
+  }
+#endif
+  for (;i<n;i++)
+    if (first[i]==value)
+      return i;
+  return n;
+}
+
+inline std::size_t simdFind(const std::int32_t* first, std::size_t n, std::int32_t value)
+{
+  std::size_t i=0;
+#if defined(LINEAR_ALGORITHMS_AVX512)
+  __m512i needle=_mm512_set1_epi32(value);
+  for (;i+16<=n;i+=16)
+  {
+    unsigned mask=_mm512_cmpeq_epi32_mask(_mm512_loadu_si512(first+i), needle);
+    if (mask!=0)
+      return i+lowestBit(mask);
+  }
+#elif defined(LINEAR_ALGORITHMS_AVX2)
+  __m256i needle=_mm256_set1_epi32(value);
+  for (;i+8<=n;i+=8)
+  {
+    __m256i equal=_mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first+i)), needle);
+    unsigned mask=_mm256_movemask_ps(_mm256_castsi256_ps(equal));
+    if (mask!=0)
+      return i+lowestBit(mask);
+  }
+#endif
+  for (;i<n;i++)
+    if (first[i]==value)
+      return i;
+  return n;
+}
+
+template <typename Element, typename Type, typename BinaryOp>
+Type reduceRange(const Element* first, std::size_t n, Type init, BinaryOp& op)
+{
+  if constexpr (std::is_same<Element, Type>::value && IsSum<Type, BinaryOp>::value && HasSimdSum<Type>::value)
+    return init+simdSum(first, n);
+  else
+  {
+    for (std::size_t i=0;i<n;i++)
+      init=op(init, first[i]);
+    return init;
+  }
+}
+
+// value is compared as it is, not converted to Element first.
+template <typename Element, typename Type>
+std::size_t findRange(const Element* first, std::size_t n, const Type& value)
+{
+  if constexpr (std::is_same<Element, Type>::value && HasSimdFind<Type>::value)
+    return simdFind(first, n, value);
+  else
+  {
+    for (std::size_t i=0;i<n;i++)
+      if (first[i]==value)
+        return i;
+    return n;
+  }
+}
+
+inline unsigned threadCount(const Parallel& policy)
+{
+  unsigned threads=policy.threads!=0 ? policy.threads : std::thread::hardware_concurrency();
+  return threads!=0 ? threads : 1;
+}
+
+// Runs task(0)..task(count-1), task(0) on the calling thread, and waits for
+// all of them before rethrowing the first exception.
+template <typename Task>
+void runTasks(std::size_t count, Task& task)
+{
+  std::vector<std::future<void>> others;
+  others.reserve(count-1);
+  std::exception_ptr failure;
+  try
+  {
+    for (std::size_t i=1;i<count;i++)
+      others.push_back(std::async(std::launch::async, [&task, i]() { task(i); }));
+    task(0);
+  }
+  catch (...)
+  {
+    failure=std::current_exception();
+  }
+  for (auto& other : others)
+  {
+    try
+    {
+      other.get();
+    }
+    catch (...)
+    {
+      if (!failure)
+        failure=std::current_exception();
+    }
+  }
+  if (failure)
+    std::rethrow_exception(failure);
+}
+
+// Splits [0, n) into equal chunks, at most one per thread, and runs
+// task(chunk, begin, end) on each.
+template <typename Task>
+std::size_t forEachChunk(const Parallel& policy, std::size_t n, Task task)
+{
+  std::size_t chunks=std::min<std::size_t>(threadCount(policy), n/MIN_CHUNK);
+  if (chunks<=1)
+  {
+    if (n!=0)
+      task(0, 0, n);
+    return n!=0 ? 1 : 0;
+  }
+  auto run=[&](std::size_t chunk) {
+    task(chunk, n*chunk/chunks, n*(chunk+1)/chunks);
+  };
+  runTasks(chunks, run);
+  return chunks;
+}
+
+// Index of the first element for which search(begin, end) reports a hit,
+// or n. Chunks give up once a hit before them is known.
+template <typename Search>
+std::size_t parallelSearch(const Parallel& policy, std::size_t n, Search search)
+{
+  std::atomic<std::size_t> found(n);
+  forEachChunk(policy, n, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t block=begin;block<end && block<found.load(std::memory_order_relaxed);block+=SEARCH_BLOCK)
+    {
+      std::size_t blockEnd=std::min(block+SEARCH_BLOCK, end);
+      std::size_t index=search(block, blockEnd);
+      if (index!=blockEnd)
+      {
+        std::size_t current=found.load(std::memory_order_relaxed);
+        while (index<current && !found.compare_exchange_weak(current, index, std::memory_order_relaxed))
+        {}
+        return;
+      }
+    }
+  });
+  return found.load();
+}
+
+template <typename Container>
+auto iteratorAt(Container& container, std::size_t index) -> decltype(container.begin())
+{
+  return container.begin()+static_cast<std::ptrdiff_t>(index);
+}
+
+// Removes serial overloads when the first argument is a policy. Otherwise a
+// non-const Parallel lvalue binds better to their Container& than to the
+// const Parallel& of the parallel overloads, and the call runs serially.
+template <typename Container>
+using NotPolicy = typename std::enable_if<!std::is_same<typename std::decay<Container>::type, Parallel>::value>::type;
+
+}
+
+template <typename Container, typename Type, typename = Detail::NotPolicy<Container>>
+void fill(Container& container, const Type& value)
+{
+  std::fill_n(container.data(), container.getSize(), value);
+}
+
+template <typename Container, typename Type>
+void fill(const Parallel& policy, Container& container, const Type& value)
+{
+  auto data=container.data();
+  Detail::forEachChunk(policy, container.getSize(), [&](std::size_t, std::size_t begin, std::size_t end) {
+    std::fill(data+begin, data+end, value);
+  });
+}
+
+// Replaces every element with op(element).
+template <typename Container, typename UnaryOp, typename = Detail::NotPolicy<Container>>
+void transform(Container& container, UnaryOp op)
+{
+  auto data=container.data();
+  for (std::size_t i=0, n=container.getSize();i<n;i++)
+    data[i]=op(data[i]);
+}
+
+template <typename Container, typename UnaryOp>
+void transform(const Parallel& policy, Container& container, UnaryOp op)
+{
+  auto data=container.data();
+  Detail::forEachChunk(policy, container.getSize(), [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t i=begin;i<end;i++)
+      data[i]=op(data[i]);
+  });
+}
+
+// Writes op(input[i]) to output[i]; output must be at least as long as input.
+template <typename Input, typename Output, typename UnaryOp, typename = Detail::NotPolicy<Input>>
+void transform(const Input& input, Output& output, UnaryOp op)
+{
+  if (output.getSize()<input.getSize())
+    throw std::out_of_range("Output is shorter than input");
+  auto from=input.data();
+  auto to=output.data();
+  for (std::size_t i=0, n=input.getSize();i<n;i++)
+    to[i]=op(from[i]);
+}
+
+template <typename Input, typename Output, typename UnaryOp>
+void transform(const Parallel& policy, const Input& input, Output& output, UnaryOp op)
+{
+  if (output.getSize()<input.getSize())
+    throw std::out_of_range("Output is shorter than input");
+  auto from=input.data();
+  auto to=output.data();
+  Detail::forEachChunk(policy, input.getSize(), [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t i=begin;i<end;i++)
+      to[i]=op(from[i]);
+  });
+}
+
+// op must be associative; sums of double may be added in any order.
+template <typename Container, typename Type, typename BinaryOp = std::plus<Type>,
+          typename = Detail::NotPolicy<Container>>
+Type reduce(const Container& container, Type init, BinaryOp op = BinaryOp())
+{
+  return Detail::reduceRange(container.data(), container.getSize(), std::move(init), op);
+}
+
+template <typename Container, typename Type, typename BinaryOp = std::plus<Type>>
+Type reduce(const Parallel& policy, const Container& container, Type init, BinaryOp op = BinaryOp())
+{
+  auto data=container.data();
+  std::vector<Type> partials(Detail::threadCount(policy), init);
+  std::size_t chunks=Detail::forEachChunk(policy, container.getSize(),
+                                          [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+    BinaryOp chunkOp=op;
+    partials[chunk]=Detail::reduceRange(data+begin+1, end-begin-1, Type(data[begin]), chunkOp);
+  });
+  for (std::size_t chunk=0;chunk<chunks;chunk++)
+    init=op(init, partials[chunk]);
+  return init;
+}
+
+template <typename Container, typename Type, typename = Detail::NotPolicy<Container>>
+auto find(Container& container, const Type& value) -> decltype(container.begin())
+{
+  return Detail::iteratorAt(container, Detail::findRange(container.data(), container.getSize(), value));
+}
+
+template <typename Container, typename Type>
+auto find(const Parallel& policy, Container& container, const Type& value) -> decltype(container.begin())
+{
+  auto data=container.data();
+  std::size_t index=Detail::parallelSearch(policy, container.getSize(), [&](std::size_t begin, std::size_t end) {
+    return begin+Detail::findRange(data+begin, end-begin, value);
+  });
+  return Detail::iteratorAt(container, index);
+}
+
+template <typename Container, typename Predicate, typename = Detail::NotPolicy<Container>>
+auto find_if(Container& container, Predicate predicate) -> decltype(container.begin())
+{
+  auto data=container.data();
+  std::size_t n=container.getSize();
+  std::size_t i=0;
+  while (i<n && !predicate(data[i]))
+    i++;
+  return Detail::iteratorAt(container, i);
+}
+
+template <typename Container, typename Predicate>
+auto find_if(const Parallel& policy, Container& container, Predicate predicate) -> decltype(container.begin())
+{
+  auto data=container.data();
+  std::size_t index=Detail::parallelSearch(policy, container.getSize(), [&](std::size_t begin, std::size_t end) {
+    while (begin<end && !predicate(data[begin]))
+      begin++;
+    return begin;
+  });
+  return Detail::iteratorAt(container, index);
+}
+
+template <typename Container, typename Compare = std::less<>, typename = Detail::NotPolicy<Container>>
+void sort(Container& container, Compare compare = Compare())
+{
+  std::sort(container.data(), container.data()+container.getSize(), compare);
+}
+
+// Sorts one chunk per thread, then merges neighbouring runs pairwise, each
+// round on half as many threads as the one before.
+template <typename Container, typename Compare = std::less<>>
+void sort(const Parallel& policy, Container& container, Compare compare = Compare())
+{
+  auto data=container.data();
+  std::vector<std::size_t> bounds(1, 0);
+  std::size_t chunks=Detail::forEachChunk(policy, container.getSize(),
+                                          [&](std::size_t, std::size_t begin, std::size_t end) {
+    std::sort(data+begin, data+end, compare);
+  });
+  for (std::size_t chunk=1;chunk<=chunks;chunk++)
+    bounds.push_back(container.getSize()*chunk/chunks);
+
+  while (bounds.size()>2)
+  {
+    std::size_t runs=bounds.size()-1;
+    auto merge=[&](std::size_t pair) {
+      std::inplace_merge(data+bounds[2*pair], data+bounds[2*pair+1], data+bounds[2*pair+2], compare);
+    };
+    Detail::runTasks(runs/2, merge);
+    std::vector<std::size_t> merged;
+    for (std::size_t i=0;i<bounds.size();i+=2)
+      merged.push_back(bounds[i]);
+    if (runs%2==1)
+      merged.push_back(bounds.back());
+    bounds.swap(merged);
+  }
+}
+
+}
+
+}
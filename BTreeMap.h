@@ -0,0 +1,957 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace Maps {
+
+// Ordered map stored as a B+ tree. Every node keeps its keys in one
+// contiguous array of a few cache lines, so a lookup touches a handful of
+// nodes instead of one node per level of a binary tree. Values live only in
+// the leaves, which are linked for in-order iteration. As keys and values
+// are stored apart, iterators yield pairs of references, with a const key,
+// rather than references to value_type.
+template <typename KeyType, typename ValueType>
+class BTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair< key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = std::pair<const key_type&, mapped_type&>;
+  using const_reference = std::pair<const key_type&, const mapped_type&>;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  static constexpr size_type KEY_BYTES = 256;
+  static constexpr size_type MAX_KEYS = KEY_BYTES/sizeof(key_type) < 4 ? 4 :
+                                        KEY_BYTES/sizeof(key_type) > 64 ? 64 :
+                                        KEY_BYTES/sizeof(key_type);
+  static constexpr size_type MIN_KEYS = MAX_KEYS/2;
+  static constexpr size_type MAX_DEPTH = 64;
+
+  struct Node
+  {
+    size_type size;
+    bool leaf;
+    key_type keys[MAX_KEYS];
+
+    explicit Node(bool leaf):size(0), leaf(leaf) {}
+  };
+
+  // The value of keys[i] is value(i). Only the first size values are
+  // constructed, so mapped types need no default constructor, and searching
+  // a leaf does not stride over them.
+  struct Leaf : Node
+  {
+    Leaf* prev;
+    Leaf* next;
+    alignas(mapped_type) unsigned char storage[MAX_KEYS*sizeof(mapped_type)];
+
+    Leaf():Node(true), prev(NULL), next(NULL) {}
+
+    ~Leaf()
+    {
+      for (size_type i=0;i<this->size;i++)
+        value(i)->~mapped_type();
+    }
+
+    mapped_type* value(size_type i)
+    {
+      return reinterpret_cast<mapped_type*>(storage)+i;
+    }
+
+    const mapped_type* value(size_type i) const
+    {
+      return reinterpret_cast<const mapped_type*>(storage)+i;
+    }
+  };
+
+  // What operator-> of an iterator returns: the pair of references it
+  // yields has no address of its own.
+  template <typename Reference>
+  struct Arrow
+  {
+    Reference entry;
+
+    const Reference* operator->() const
+    {
+      return &entry;
+    }
+  };
+
+  // Moves the value in slot j of from into the empty slot i of to, leaving
+  // slot j empty.
+  static void moveValue(Leaf* to, size_type i, Leaf* from, size_type j)
+  {
+    new (to->value(i)) mapped_type(std::move(*from->value(j)));
+    from->value(j)->~mapped_type();
+  }
+
+  // children[i] holds keys below keys[i], children[i+1] keys from keys[i] on.
+  struct Internal : Node
+  {
+    Node* children[MAX_KEYS+1];
+
+    Internal():Node(false) {}
+  };
+
+  // Internal nodes passed on the way down and the child index taken in each.
+  struct Path
+  {
+    Internal* nodes[MAX_DEPTH];
+    size_type indices[MAX_DEPTH];
+    size_type depth;
+  };
+
+  Node* root;
+  Leaf* firstLeaf;
+  Leaf* lastLeaf;
+  size_type counter;
+
+public:
+  BTreeMap():root(NULL), firstLeaf(NULL), lastLeaf(NULL), counter(0)
+  {}
+
+  BTreeMap(std::initializer_list<value_type> list) : BTreeMap()
+  {
+    for (auto it = list.begin(); it != list.end(); ++it)
+      insert_or_assign((*it).first, (*it).second);
+  }
+
+  BTreeMap(const BTreeMap& other) : BTreeMap()
+  {
+    *this=other;
+  }
+
+  BTreeMap(BTreeMap&& other) : BTreeMap()
+  {
+    *this=std::move(other);
+  }
+
+  BTreeMap& operator=(const BTreeMap& other)
+  {
+    if (this == &other)
+      return *this;
+    erase();
+    if (other.root==NULL)
+      return *this;
+    Leaf* previous=NULL;
+    root=clone(other.root, previous);
+    lastLeaf=previous;
+    counter=other.counter;
+    return *this;
+  }
+
+  BTreeMap& operator=(BTreeMap&& other)
+  {
+    if (this == &other)
+      return *this;
+    erase();
+    root=other.root;
+    firstLeaf=other.firstLeaf;
+    lastLeaf=other.lastLeaf;
+    counter=other.counter;
+    other.root=NULL;
+    other.firstLeaf=NULL;
+    other.lastLeaf=NULL;
+    other.counter=0;
+    return *this;
+  }
+
+  ~BTreeMap()
+  {
+    erase();
+  }
+
+////////////////////////////////////////////////////////////////////////////////
+private:
+  // Number of keys in node below key, or with orEqual not above it. For
+  // arithmetic keys this is a branch-free count over the contiguous array,
+  // which the compiler turns into SIMD compares; other keys are bisected.
+  static size_type countKeys(const Node* node, const key_type& key, bool orEqual)
+  {
+    return countKeys(node, key, orEqual, std::is_arithmetic<key_type>());
+  }
+
+  static size_type countKeys(const Node* node, const key_type& key, bool orEqual, std::true_type)
+  {
+    size_type result=0;
+    if (orEqual)
+      for (size_type i=0;i<node->size;i++)
+        result+=!(key<node->keys[i]);
+    else
+      for (size_type i=0;i<node->size;i++)
+        result+=node->keys[i]<key;
+    return result;
+  }
+
+  static size_type countKeys(const Node* node, const key_type& key, bool orEqual, std::false_type)
+  {
+    size_type low=0;
+    size_type high=node->size;
+    while (low<high)
+    {
+      size_type middle=low+(high-low)/2;
+      if (orEqual ? !(key<node->keys[middle]) : node->keys[middle]<key)
+        low=middle+1;
+      else
+        high=middle;
+    }
+    return low;
+  }
+
+  Leaf* descend(const key_type& key, Path* path) const
+  {
+    Node* node=root;
+    if (path!=NULL)
+      path->depth=0;
+    while (!node->leaf)
+    {
+      Internal* internal=static_cast<Internal*>(node);
+      size_type index=countKeys(internal, key, true);
+      if (path!=NULL)
+      {
+        path->nodes[path->depth]=internal;
+        path->indices[path->depth]=index;
+        path->depth++;
+      }
+      node=internal->children[index];
+    }
+    return static_cast<Leaf*>(node);
+  }
+
+  // Leaf and index of key, or a NULL leaf if it is absent.
+  std::pair<Leaf*, size_type> findPosition(const key_type& key) const
+  {
+    if (root!=NULL)
+    {
+      Leaf* leaf=descend(key, NULL);
+      size_type index=countKeys(leaf, key, false);
+      if (index<leaf->size && !(key<leaf->keys[index]))
+        return std::make_pair(leaf, index);
+    }
+    return std::make_pair(static_cast<Leaf*>(NULL), size_type(0));
+  }
+
+  static void destroy(Node* node)
+  {
+    if (node->leaf)
+    {
+      delete static_cast<Leaf*>(node);
+      return;
+    }
+    Internal* internal=static_cast<Internal*>(node);
+    for (size_type i=0;i<=internal->size;i++)
+      destroy(internal->children[i]);
+    delete internal;
+  }
+
+  Node* clone(const Node* node, Leaf*& previous)
+  {
+    if (node->leaf)
+    {
+      const Leaf* source=static_cast<const Leaf*>(node);
+      Leaf* leaf=new Leaf;
+      for (size_type i=0;i<source->size;i++)
+      {
+        leaf->keys[i]=source->keys[i];
+        new (leaf->value(i)) mapped_type(*source->value(i));
+        leaf->size++;
+      }
+      leaf->prev=previous;
+      if (previous==NULL)
+        firstLeaf=leaf;
+      else
+        previous->next=leaf;
+      previous=leaf;
+      return leaf;
+    }
+    const Internal* source=static_cast<const Internal*>(node);
+    Internal* internal=new Internal;
+    internal->size=source->size;
+    for (size_type i=0;i<source->size;i++)
+      internal->keys[i]=source->keys[i];
+    for (size_type i=0;i<=source->size;i++)
+      internal->children[i]=clone(source->children[i], previous);
+    return internal;
+  }
+
+  void linkAfter(Leaf* leaf, Leaf* sibling)
+  {
+    sibling->prev=leaf;
+    sibling->next=leaf->next;
+    if (leaf->next!=NULL)
+      leaf->next->prev=sibling;
+    else
+      lastLeaf=sibling;
+    leaf->next=sibling;
+  }
+
+  void unlink(Leaf* leaf)
+  {
+    if (leaf->prev!=NULL)
+      leaf->prev->next=leaf->next;
+    else
+      firstLeaf=leaf->next;
+    if (leaf->next!=NULL)
+      leaf->next->prev=leaf->prev;
+    else
+      lastLeaf=leaf->prev;
+  }
+
+  // Puts element at index of the leaf at the end of path, splitting the leaf
+  // and its ancestors as needed. Returns where the element ended up.
+  std::pair<Leaf*, size_type> insertAt(Leaf* leaf, size_type index, key_type&& key, mapped_type&& value, Path& path)
+  {
+    if (leaf->size<MAX_KEYS)
+    {
+      insertIntoLeaf(leaf, index, std::move(key), std::move(value));
+      return std::make_pair(leaf, index);
+    }
+    Leaf* sibling=new Leaf;
+    linkAfter(leaf, sibling);
+    // Of the MAX_KEYS+1 elements the lower half stays, the rest moves right.
+    size_type leftSize=(MAX_KEYS+1)/2;
+    size_type firstMoved= index<leftSize ? leftSize-1 : leftSize;
+    for (size_type i=firstMoved;i<MAX_KEYS;i++)
+    {
+      sibling->keys[i-firstMoved]=std::move(leaf->keys[i]);
+      moveValue(sibling, i-firstMoved, leaf, i);
+    }
+    sibling->size=MAX_KEYS-firstMoved;
+    leaf->size=firstMoved;
+    std::pair<Leaf*, size_type> position;
+    if (index<leftSize)
+      position=std::make_pair(leaf, index);
+    else
+      position=std::make_pair(sibling, index-firstMoved);
+    insertIntoLeaf(position.first, position.second, std::move(key), std::move(value));
+    insertIntoParent(path, sibling->keys[0], sibling);
+    return position;
+  }
+
+  static void insertIntoLeaf(Leaf* leaf, size_type index, key_type&& key, mapped_type&& value)
+  {
+    for (size_type i=leaf->size;i>index;i--)
+    {
+      leaf->keys[i]=std::move(leaf->keys[i-1]);
+      moveValue(leaf, i, leaf, i-1);
+    }
+    leaf->keys[index]=std::move(key);
+    new (leaf->value(index)) mapped_type(std::move(value));
+    leaf->size++;
+  }
+
+  // Adds separator and the node right of it to the last internal node of
+  // path. A full node is split and its middle key moves one level up.
+  void insertIntoParent(Path& path, key_type separator, Node* right)
+  {
+    while (path.depth!=0)
+    {
+      path.depth--;
+      Internal* parent=path.nodes[path.depth];
+      size_type index=path.indices[path.depth];
+      if (parent->size<MAX_KEYS)
+      {
+        insertIntoInternal(parent, index, std::move(separator), right);
+        return;
+      }
+      key_type keys[MAX_KEYS+1];
+      Node* children[MAX_KEYS+2];
+      for (size_type i=0, j=0;i<=MAX_KEYS;i++)
+        keys[i]= i==index ? std::move(separator) : std::move(parent->keys[j++]);
+      for (size_type i=0, j=0;i<=MAX_KEYS+1;i++)
+        children[i]= i==index+1 ? right : parent->children[j++];
+
+      Internal* sibling=new Internal;
+      size_type leftSize=(MAX_KEYS+1)/2;
+      parent->size=leftSize;
+      for (size_type i=0;i<leftSize;i++)
+        parent->keys[i]=std::move(keys[i]);
+      for (size_type i=0;i<=leftSize;i++)
+        parent->children[i]=children[i];
+      sibling->size=MAX_KEYS-leftSize;
+      for (size_type i=0;i<sibling->size;i++)
+        sibling->keys[i]=std::move(keys[leftSize+1+i]);
+      for (size_type i=0;i<=sibling->size;i++)
+        sibling->children[i]=children[leftSize+1+i];
+      separator=std::move(keys[leftSize]);
+      right=sibling;
+    }
+    Internal* newRoot=new Internal;
+    newRoot->size=1;
+    newRoot->keys[0]=std::move(separator);
+    newRoot->children[0]=root;
+    newRoot->children[1]=right;
+    root=newRoot;
+  }
+
+  static void insertIntoInternal(Internal* node, size_type index, key_type&& separator, Node* right)
+  {
+    for (size_type i=node->size;i>index;i--)
+    {
+      node->keys[i]=std::move(node->keys[i-1]);
+      node->children[i+1]=node->children[i];
+    }
+    node->keys[index]=std::move(separator);
+    node->children[index+1]=right;
+    node->size++;
+  }
+
+  // Removes key index and child index+1 of an internal node.
+  static void removeFromInternal(Internal* node, size_type index)
+  {
+    for (size_type i=index;i+1<node->size;i++)
+    {
+      node->keys[i]=std::move(node->keys[i+1]);
+      node->children[i+1]=node->children[i+2];
+    }
+    node->size--;
+    node->keys[node->size]=key_type();
+  }
+
+  void removeAt(Leaf* leaf, size_type index, Path& path)
+  {
+    leaf->value(index)->~mapped_type();
+    for (size_type i=index;i+1<leaf->size;i++)
+    {
+      leaf->keys[i]=std::move(leaf->keys[i+1]);
+      moveValue(leaf, i, leaf, i+1);
+    }
+    leaf->size--;
+    leaf->keys[leaf->size]=key_type();
+    counter--;
+    rebalance(leaf, path);
+  }
+
+  // Refills a node that dropped below MIN_KEYS from a sibling, or merges it
+  // with one and continues with the parent, which lost a key.
+  void rebalance(Node* node, Path& path)
+  {
+    while (path.depth!=0)
+    {
+      if (node->size>=MIN_KEYS)
+        return;
+      Internal* parent=path.nodes[path.depth-1];
+      size_type index=path.indices[path.depth-1];
+      Node* left= index>0 ? parent->children[index-1] : NULL;
+      Node* right= index<parent->size ? parent->children[index+1] : NULL;
+      if (left!=NULL && left->size>MIN_KEYS)
+      {
+        borrowFromLeft(parent, index);
+        return;
+      }
+      if (right!=NULL && right->size>MIN_KEYS)
+      {
+        borrowFromRight(parent, index);
+        return;
+      }
+      if (left!=NULL)
+        merge(parent, index-1);
+      else
+        merge(parent, index);
+      path.depth--;
+      node=parent;
+    }
+    if (node->size!=0)
+      return;
+    if (node->leaf)
+    {
+      delete static_cast<Leaf*>(node);
+      root=NULL;
+      firstLeaf=NULL;
+      lastLeaf=NULL;
+    }
+    else
+    {
+      root=static_cast<Internal*>(node)->children[0];
+      delete static_cast<Internal*>(node);
+    }
+  }
+
+  static void borrowFromLeft(Internal* parent, size_type index)
+  {
+    Node* node=parent->children[index];
+    Node* left=parent->children[index-1];
+    for (size_type i=node->size;i>0;i--)
+      node->keys[i]=std::move(node->keys[i-1]);
+    if (node->leaf)
+    {
+      Leaf* leaf=static_cast<Leaf*>(node);
+      Leaf* source=static_cast<Leaf*>(left);
+      for (size_type i=leaf->size;i>0;i--)
+        moveValue(leaf, i, leaf, i-1);
+      leaf->keys[0]=std::move(source->keys[source->size-1]);
+      moveValue(leaf, 0, source, source->size-1);
+      source->keys[source->size-1]=key_type();
+      parent->keys[index-1]=leaf->keys[0];
+    }
+    else
+    {
+      Internal* internal=static_cast<Internal*>(node);
+      Internal* source=static_cast<Internal*>(left);
+      for (size_type i=internal->size+1;i>0;i--)
+        internal->children[i]=internal->children[i-1];
+      internal->keys[0]=std::move(parent->keys[index-1]);
+      internal->children[0]=source->children[source->size];
+      parent->keys[index-1]=std::move(source->keys[source->size-1]);
+      source->keys[source->size-1]=key_type();
+    }
+    node->size++;
+    left->size--;
+  }
+
+  static void borrowFromRight(Internal* parent, size_type index)
+  {
+    Node* node=parent->children[index];
+    Node* right=parent->children[index+1];
+    if (node->leaf)
+    {
+      Leaf* leaf=static_cast<Leaf*>(node);
+      Leaf* source=static_cast<Leaf*>(right);
+      leaf->keys[leaf->size]=std::move(source->keys[0]);
+      moveValue(leaf, leaf->size, source, 0);
+      for (size_type i=0;i+1<source->size;i++)
+      {
+        source->keys[i]=std::move(source->keys[i+1]);
+        moveValue(source, i, source, i+1);
+      }
+      source->keys[source->size-1]=key_type();
+      parent->keys[index]=source->keys[0];
+    }
+    else
+    {
+      Internal* internal=static_cast<Internal*>(node);
+      Internal* source=static_cast<Internal*>(right);
+      internal->keys[internal->size]=std::move(parent->keys[index]);
+      internal->children[internal->size+1]=source->children[0];
+      parent->keys[index]=std::move(source->keys[0]);
+      for (size_type i=0;i+1<source->size;i++)
+        source->keys[i]=std::move(source->keys[i+1]);
+      for (size_type i=0;i<source->size;i++)
+        source->children[i]=source->children[i+1];
+      source->keys[source->size-1]=key_type();
+    }
+    node->size++;
+    right->size--;
+  }
+
+  // Moves child index+1 of parent into child index and drops the separator.
+  void merge(Internal* parent, size_type index)
+  {
+    Node* left=parent->children[index];
+    Node* right=parent->children[index+1];
+    if (left->leaf)
+    {
+      Leaf* target=static_cast<Leaf*>(left);
+      Leaf* source=static_cast<Leaf*>(right);
+      for (size_type i=0;i<source->size;i++)
+      {
+        target->keys[target->size+i]=std::move(source->keys[i]);
+        moveValue(target, target->size+i, source, i);
+      }
+      target->size+=source->size;
+      source->size=0;
+      unlink(source);
+      delete source;
+    }
+    else
+    {
+      Internal* target=static_cast<Internal*>(left);
+      Internal* source=static_cast<Internal*>(right);
+      target->keys[target->size]=std::move(parent->keys[index]);
+      for (size_type i=0;i<source->size;i++)
+        target->keys[target->size+1+i]=std::move(source->keys[i]);
+      for (size_type i=0;i<=source->size;i++)
+        target->children[target->size+1+i]=source->children[i];
+      target->size+=source->size+1;
+      delete source;
+    }
+    removeFromInternal(parent, index);
+  }
+
+  template <typename KArg, typename... Args>
+  std::pair<std::pair<Leaf*, size_type>, bool> emplaceKey(KArg&& key, Args&&... args)
+  {
+    if (root==NULL)
+    {
+      Leaf* leaf=new Leaf;
+      root=leaf;
+      firstLeaf=leaf;
+      lastLeaf=leaf;
+    }
+    Path path;
+    Leaf* leaf=descend(key, &path);
+    size_type index=countKeys(leaf, key, false);
+    if (index<leaf->size && !(key<leaf->keys[index]))
+      return std::make_pair(std::make_pair(leaf, index), false);
+    key_type newKey(std::forward<KArg>(key));
+    mapped_type value(std::forward<Args>(args)...);
+    auto position=insertAt(leaf, index, std::move(newKey), std::move(value), path);
+    counter++;
+    return std::make_pair(position, true);
+  }
+
+  template <typename KArg, typename M>
+  std::pair<std::pair<Leaf*, size_type>, bool> assignKey(KArg&& key, M&& value)
+  {
+    auto position=findPosition(key);
+    if (position.first!=NULL)
+    {
+      *position.first->value(position.second)=std::forward<M>(value);
+      return std::make_pair(position, false);
+    }
+    return emplaceKey(std::forward<KArg>(key), std::forward<M>(value));
+  }
+
+  iterator iteratorAt(std::pair<Leaf*, size_type> position) const
+  {
+    Iterator it;
+    it.leaf=position.first;
+    it.index=position.second;
+    it.tree=this;
+    return it;
+  }
+
+////////////////////////////////////////////////////////////////////////////////
+public:
+  bool isEmpty() const
+  {
+    return counter==0;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    auto position=emplaceKey(key).first;
+    return *position.first->value(position.second);
+  }
+
+  mapped_type& operator[](key_type&& key)
+  {
+    auto position=emplaceKey(std::move(key)).first;
+    return *position.first->value(position.second);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+  {
+    auto result=emplaceKey(key, std::forward<Args>(args)...);
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+  {
+    auto result=emplaceKey(std::move(key), std::forward<Args>(args)...);
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args)
+  {
+    value_type element(std::forward<Args>(args)...);
+    auto result=emplaceKey(std::move(element.first), std::move(element.second));
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value)
+  {
+    auto result=assignKey(key, std::forward<M>(value));
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value)
+  {
+    auto result=assignKey(std::move(key), std::forward<M>(value));
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if (counter==0)
+      throw std::out_of_range ("Calling valueOf() when the map is empty");
+    auto position=findPosition(key);
+    if (position.first==NULL)
+      throw std::out_of_range ("Calling valueOf() with nonexisting key");
+    return *position.first->value(position.second);
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    if (counter==0)
+      throw std::out_of_range ("Calling valueOf() when the map is empty");
+    auto position=findPosition(key);
+    if (position.first==NULL)
+      throw std::out_of_range ("Calling valueOf() with nonexisting key");
+    return *position.first->value(position.second);
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    return iteratorAt(findPosition(key));
+  }
+
+  iterator find(const key_type& key)
+  {
+    return iteratorAt(findPosition(key));
+  }
+
+  void remove(const key_type& key)
+  {
+    if (root==NULL)
+      throw std::out_of_range ("Removal of nonexisting node");
+    Path path;
+    Leaf* leaf=descend(key, &path);
+    size_type index=countKeys(leaf, key, false);
+    if (index==leaf->size || key<leaf->keys[index])
+      throw std::out_of_range ("Removal of nonexisting node");
+    removeAt(leaf, index, path);
+  }
+
+  void remove(const const_iterator& it)
+  {
+    if (it.leaf==NULL)
+      throw std::out_of_range ("Removal of nonexisting node");
+    key_type key=it.leaf->keys[it.index];
+    remove(key);
+  }
+
+  void erase()
+  {
+    if (root!=NULL)
+      destroy(root);
+    root=NULL;
+    firstLeaf=NULL;
+    lastLeaf=NULL;
+    counter=0;
+  }
+
+  size_type getSize() const
+  {
+    return counter;
+  }
+
+  bool operator==(const BTreeMap& other) const
+  {
+    if (counter!=other.counter)
+      return 0;
+
+    auto itThis=begin();
+    for (auto it=other.begin(); it!=other.end();it++)
+      {
+        if (*it != *itThis)
+          return 0;
+        itThis++;
+      }
+      return 1;
+  }
+
+  bool operator!=(const BTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+
+  iterator begin()
+  {
+    return iteratorAt(std::make_pair(firstLeaf, size_type(0)));
+  }
+
+  iterator end()
+  {
+    return iteratorAt(std::make_pair(static_cast<Leaf*>(NULL), size_type(0)));
+  }
+
+  const_iterator cbegin() const
+  {
+    return iteratorAt(std::make_pair(firstLeaf, size_type(0)));
+  }
+
+  const_iterator cend() const
+  {
+    return iteratorAt(std::make_pair(static_cast<Leaf*>(NULL), size_type(0)));
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+
+template <typename KeyType, typename ValueType>
+class BTreeMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename BTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename BTreeMap::value_type;
+  using pointer = typename BTreeMap::template Arrow<reference>;
+  friend BTreeMap;
+
+private:
+  Leaf* leaf;
+  size_type index;
+  const BTreeMap* tree;
+public:
+
+  explicit ConstIterator():leaf(NULL), index(0), tree(NULL)
+  {}
+
+  ConstIterator(const ConstIterator& other)
+    : leaf(other.leaf), index(other.index), tree(other.tree)
+  {}
+
+  ConstIterator& operator=(const ConstIterator& other)
+  {
+    leaf=other.leaf;
+    index=other.index;
+    tree=other.tree;
+    return *this;
+  }
+
+  ConstIterator& operator++()
+  {
+    if (leaf==NULL)
+      throw std::out_of_range("Wrong pointer at operator++");
+    index++;
+    if (index==leaf->size)
+    {
+      leaf=leaf->next;
+      index=0;
+    }
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto result = *this;
+    ++(*this);
+    return result;
+  }
+
+  ConstIterator& operator--()
+  {
+    if (leaf==NULL)
+    {
+      if (tree==NULL || tree->lastLeaf==NULL)
+        throw std::out_of_range("Wrong pointer at operator--");
+      leaf=tree->lastLeaf;
+      index=leaf->size-1;
+      return *this;
+    }
+    if (index==0)
+    {
+      if (leaf->prev==NULL)
+        throw std::out_of_range("Wrong pointer at operator--");
+      leaf=leaf->prev;
+      index=leaf->size;
+    }
+    index--;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto result = *this;
+    --(*this);
+    return result;
+  }
+
+  reference operator*() const
+  {
+    if (leaf==NULL)
+      throw std::out_of_range("Wrong pointer at operator*");
+    return reference(leaf->keys[index], *leaf->value(index));
+  }
+
+  pointer operator->() const
+  {
+    return pointer{this->operator*()};
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return leaf == other.leaf && index == other.index;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+
+template <typename KeyType, typename ValueType>
+class BTreeMap<KeyType, ValueType>::Iterator : public BTreeMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename BTreeMap::reference;
+  using pointer = typename BTreeMap::template Arrow<reference>;
+
+  explicit Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return pointer{this->operator*()};
+  }
+
+  reference operator*() const
+  {
+    auto entry=ConstIterator::operator*();
+    // ugly cast, yet reduces code duplication.
+    return reference(entry.first, const_cast<typename BTreeMap::mapped_type&>(entry.second));
+  }
+};
+
+}
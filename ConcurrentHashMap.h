@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <utility>
+
+#include "HashMap.h"
+
+namespace Maps {
+
+// HashMap split into ShardCount independently locked shards. Readers of a
+// shard share its lock, so they only wait for writers of the same shard.
+// Values are returned by copy or visited under the shard lock, because a
+// reference into a shard would not survive a concurrent rehash.
+template <typename KeyType, typename ValueType, typename Hash = std::hash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>, std::size_t ShardCount = 64>
+class ConcurrentHashMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<key_type, mapped_type>;
+  using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+  static_assert(ShardCount!=0 && (ShardCount&(ShardCount-1))==0, "ShardCount must be a power of two");
+
+private:
+  static constexpr size_type CACHE_LINE = 64;
+
+  // Each shard starts on its own cache line, so writers to neighbouring
+  // shards do not invalidate each other's lock and counter.
+  struct alignas(CACHE_LINE) Shard
+  {
+    mutable std::shared_mutex lock;
+    std::atomic<size_type> counter;
+    HashMap<KeyType, ValueType, Hash, KeyEqual> map;
+
+    Shard():counter(0) {}
+  };
+
+  Shard shards[ShardCount];
+  Hash hash;
+
+  // The shard is picked from the top bits of a multiplicative hash, so it is
+  // independent of the low bits the shard's own table probes with.
+  Shard& shardOf(const key_type& key)
+  {
+    return shards[shardIndex(key)];
+  }
+
+  const Shard& shardOf(const key_type& key) const
+  {
+    return shards[shardIndex(key)];
+  }
+
+  size_type shardIndex(const key_type& key) const
+  {
+    if constexpr (ShardCount==1)
+      return 0;
+    else
+    {
+      std::uint64_t hashedKey=hash(key);
+      hashedKey*=0x9E3779B97F4A7C15ULL;
+      return static_cast<size_type>(hashedKey>>(64-shardBits()));
+    }
+  }
+
+  static constexpr unsigned shardBits(size_type count=ShardCount)
+  {
+    return count<=1 ? 0 : 1+shardBits(count/2);
+  }
+
+public:
+  ConcurrentHashMap()
+  {}
+
+  ConcurrentHashMap(std::initializer_list<value_type> list):ConcurrentHashMap()
+  {
+    for (auto it = list.begin(); it != list.end(); ++it)
+      insert_or_assign((*it).first, (*it).second);
+  }
+
+  ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+  ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+  bool isEmpty() const
+  {
+    return getSize()==0;
+  }
+
+  // Sum of the per-shard counters; exact only while no writer is active.
+  size_type getSize() const
+  {
+    size_type size=0;
+    for (size_type index=0;index<ShardCount;index++)
+      size+=shards[index].counter.load(std::memory_order_relaxed);
+    return size;
+  }
+
+  template <typename... Args>
+  bool try_emplace(const key_type& key, Args&&... args)
+  {
+    Shard& shard=shardOf(key);
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    bool inserted=shard.map.try_emplace(key, std::forward<Args>(args)...).second;
+    if (inserted)
+      shard.counter.store(shard.map.getSize(), std::memory_order_relaxed);
+    return inserted;
+  }
+
+  template <typename M>
+  bool insert_or_assign(const key_type& key, M&& value)
+  {
+    Shard& shard=shardOf(key);
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    bool inserted=shard.map.insert_or_assign(key, std::forward<M>(value)).second;
+    if (inserted)
+      shard.counter.store(shard.map.getSize(), std::memory_order_relaxed);
+    return inserted;
+  }
+
+  mapped_type valueOf(const key_type& key) const
+  {
+    const Shard& shard=shardOf(key);
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+    if (shard.map.isEmpty())
+      throw std::out_of_range ("Calling valueOf() with nonexisting key");
+    return shard.map.valueOf(key);
+  }
+
+  bool contains(const key_type& key) const
+  {
+    const Shard& shard=shardOf(key);
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+    return shard.map.find(key)!=shard.map.end();
+  }
+
+  // Calls visitor(const mapped_type&) under the shard's shared lock.
+  // Returns false if the key is not present.
+  template <typename Visitor>
+  bool visit(const key_type& key, Visitor visitor) const
+  {
+    const Shard& shard=shardOf(key);
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+    auto it=shard.map.find(key);
+    if (it==shard.map.end())
+      return false;
+    visitor((*it).second);
+    return true;
+  }
+
+  // Calls updater(mapped_type&) under the shard's exclusive lock, inserting
+  // a value-initialized mapped_type first if the key is not present.
+  template <typename Updater>
+  void update(const key_type& key, Updater updater)
+  {
+    Shard& shard=shardOf(key);
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    updater(shard.map[key]);
+    shard.counter.store(shard.map.getSize(), std::memory_order_relaxed);
+  }
+
+  void remove(const key_type& key)
+  {
+    Shard& shard=shardOf(key);
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    shard.map.remove(key);
+    shard.counter.store(shard.map.getSize(), std::memory_order_relaxed);
+  }
+
+  void erase()
+  {
+    for (size_type index=0;index<ShardCount;index++)
+    {
+      std::unique_lock<std::shared_mutex> guard(shards[index].lock);
+      shards[index].map.erase();
+      shards[index].counter.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Visits every entry one shard at a time, holding that shard's shared
+  // lock; the result is not a snapshot of the whole map.
+  template <typename Visitor>
+  void forEach(Visitor visitor) const
+  {
+    for (size_type index=0;index<ShardCount;index++)
+    {
+      std::shared_lock<std::shared_mutex> guard(shards[index].lock);
+      for (auto it=shards[index].map.begin();it!=shards[index].map.end();++it)
+        visitor(static_cast<const value_type&>(*it));
+    }
+  }
+};
+
+}
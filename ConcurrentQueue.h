@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "HazardPointers.h"
+
+namespace Linear
+{
+
+// Lock-free multi-producer, multi-consumer FIFO queue (Michael and Scott).
+// append and popFirst match LinkedList, so a mutex-guarded LinkedList used
+// as a work queue can be swapped for it. Removed nodes are reclaimed through
+// Memory::HazardPointers. There is no getSize(): under concurrent use it
+// would be stale before it returned.
+template <typename Type>
+class ConcurrentQueue
+{
+public:
+  using value_type = Type;
+  using size_type = std::size_t;
+  using reference = Type&;
+  using const_reference = const Type&;
+
+private:
+  static constexpr size_type CACHE_LINE = 64;
+
+  // The first node is a dummy whose value has been taken or never existed;
+  // every node after it holds a live value in storage.
+  struct Node
+  {
+    std::atomic<Node*> next;
+    alignas(Type) unsigned char storage[sizeof(Type)];
+
+    Node() : next(NULL)
+    {}
+
+    Type* value()
+    {
+      return reinterpret_cast<Type*>(storage);
+    }
+  };
+
+  // Ends the life of a dequeued value even if moving it out throws.
+  struct ValueDestroyer
+  {
+    Type* value;
+
+    ~ValueDestroyer()
+    {
+      value->~Type();
+    }
+  };
+
+  // Producers work on tail and consumers on head, so they sit on separate
+  // cache lines.
+  alignas(CACHE_LINE) std::atomic<Node*> head;
+  alignas(CACHE_LINE) std::atomic<Node*> tail;
+
+public:
+  ConcurrentQueue()
+  {
+    Node* dummy=new Node;
+    head.store(dummy, std::memory_order_relaxed);
+    tail.store(dummy, std::memory_order_relaxed);
+  }
+
+  ConcurrentQueue(const ConcurrentQueue&) = delete;
+  ConcurrentQueue& operator=(const ConcurrentQueue&) = delete;
+
+  // No other thread may use the queue any more.
+  ~ConcurrentQueue()
+  {
+    Node* node=head.load(std::memory_order_relaxed);
+    Node* next=node->next.load(std::memory_order_relaxed);
+    delete node;
+    while (next!=NULL)
+    {
+      node=next;
+      next=node->next.load(std::memory_order_relaxed);
+      node->value()->~Type();
+      delete node;
+    }
+  }
+
+private:
+  template <typename... Args>
+  void emplace(Args&&... args)
+  {
+    Node* node=new Node;
+    try
+    {
+      new (node->storage) Type(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      delete node;
+      throw;
+    }
+    Memory::HazardPointers::Guard lastGuard;
+    for (;;)
+    {
+      Node* last=lastGuard.protect(tail);
+      Node* next=last->next.load(std::memory_order_acquire);
+      if (last!=tail.load(std::memory_order_acquire))
+        continue;
+      if (next!=NULL)
+      {
+        // Another append linked its node but has not moved tail yet.
+        tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+        continue;
+      }
+      if (last->next.compare_exchange_weak(next, node, std::memory_order_release, std::memory_order_relaxed))
+      {
+        tail.compare_exchange_strong(last, node, std::memory_order_release, std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+  // Unlinks the first value's node, which becomes the new dummy, and
+  // returns it protected by valueGuard; NULL when the queue is empty. The
+  // caller moves the value out and destroys it.
+  Node* dequeue(Memory::HazardPointers::Guard& valueGuard)
+  {
+    Memory::HazardPointers::Guard firstGuard;
+    for (;;)
+    {
+      Node* first=firstGuard.protect(head);
+      Node* last=tail.load(std::memory_order_acquire);
+      Node* next=valueGuard.protect(first->next);
+      if (first!=head.load(std::memory_order_acquire))
+        continue;
+      if (next==NULL)
+        return NULL;
+      if (first==last)
+      {
+        tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+        continue;
+      }
+      if (head.compare_exchange_weak(first, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+      {
+        firstGuard.reset();
+        Memory::HazardPointers::retire(first);
+        return next;
+      }
+    }
+  }
+
+public:
+  // True if the queue was empty at some moment during the call.
+  bool isEmpty() const
+  {
+    Memory::HazardPointers::Guard firstGuard;
+    Node* first=firstGuard.protect(head);
+    return first->next.load(std::memory_order_acquire)==NULL;
+  }
+
+  void append(const Type& item)
+  {
+    emplace(item);
+  }
+
+  void append(Type&& item)
+  {
+    emplace(std::move(item));
+  }
+
+  Type popFirst()
+  {
+    Memory::HazardPointers::Guard valueGuard;
+    Node* node=dequeue(valueGuard);
+    if (node==NULL) throw std::out_of_range("An attempt to pop first element from empty queue was made");
+    ValueDestroyer destroyer{node->value()};
+    return std::move(*node->value());
+  }
+
+  // Moves the first element into item; false if the queue was empty.
+  bool tryPopFirst(Type& item)
+  {
+    Memory::HazardPointers::Guard valueGuard;
+    Node* node=dequeue(valueGuard);
+    if (node==NULL)
+      return false;
+    ValueDestroyer destroyer{node->value()};
+    item=std::move(*node->value());
+    return true;
+  }
+};
+
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "HazardPointers.h"
+
+namespace Linear
+{
+
+// Lock-free multi-producer, multi-consumer LIFO stack (Treiber). append and
+// popLast match LinkedList used as a stack. Popped nodes are reclaimed
+// through Memory::HazardPointers, which also rules out the ABA problem: a
+// node cannot be freed and reused while a popping thread still names it.
+template <typename Type>
+class ConcurrentStack
+{
+public:
+  using value_type = Type;
+  using size_type = std::size_t;
+  using reference = Type&;
+  using const_reference = const Type&;
+
+private:
+  // The value is destroyed by the thread that pops the node, so the node
+  // itself only has to free memory when it is retired.
+  struct Node
+  {
+    Node* next;
+    alignas(Type) unsigned char storage[sizeof(Type)];
+
+    Node() : next(NULL)
+    {}
+
+    Type* value()
+    {
+      return reinterpret_cast<Type*>(storage);
+    }
+  };
+
+  struct ValueDestroyer
+  {
+    Type* value;
+
+    ~ValueDestroyer()
+    {
+      value->~Type();
+    }
+  };
+
+  std::atomic<Node*> top;
+
+public:
+  ConcurrentStack() : top(NULL)
+  {}
+
+  ConcurrentStack(const ConcurrentStack&) = delete;
+  ConcurrentStack& operator=(const ConcurrentStack&) = delete;
+
+  // No other thread may use the stack any more.
+  ~ConcurrentStack()
+  {
+    Node* node=top.load(std::memory_order_relaxed);
+    while (node!=NULL)
+    {
+      Node* next=node->next;
+      node->value()->~Type();
+      delete node;
+      node=next;
+    }
+  }
+
+private:
+  template <typename... Args>
+  void emplace(Args&&... args)
+  {
+    Node* node=new Node;
+    try
+    {
+      new (node->storage) Type(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      delete node;
+      throw;
+    }
+    node->next=top.load(std::memory_order_relaxed);
+    while (!top.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+    {}
+  }
+
+  // Unlinks the top node and returns it protected by guard; NULL when the
+  // stack is empty. The caller moves the value out, destroys it and retires
+  // the node.
+  Node* pop(Memory::HazardPointers::Guard& guard)
+  {
+    for (;;)
+    {
+      Node* node=guard.protect(top);
+      if (node==NULL)
+        return NULL;
+      // node cannot have been freed, so its next is safe to read; if node
+      // was popped meanwhile the exchange below fails.
+      Node* next=node->next;
+      if (top.compare_exchange_weak(node, next, std::memory_order_acquire, std::memory_order_relaxed))
+        return node;
+    }
+  }
+
+public:
+  // True if the stack was empty at some moment during the call.
+  bool isEmpty() const
+  {
+    return top.load(std::memory_order_acquire)==NULL;
+  }
+
+  void append(const Type& item)
+  {
+    emplace(item);
+  }
+
+  void append(Type&& item)
+  {
+    emplace(std::move(item));
+  }
+
+  Type popLast()
+  {
+    Memory::HazardPointers::Guard guard;
+    Node* node=pop(guard);
+    if (node==NULL) throw std::out_of_range("An attempt to pop last element from empty stack was made");
+    Memory::HazardPointers::retire(node);
+    ValueDestroyer destroyer{node->value()};
+    return std::move(*node->value());
+  }
+
+  // Moves the last element into item; false if the stack was empty.
+  bool tryPopLast(Type& item)
+  {
+    Memory::HazardPointers::Guard guard;
+    Node* node=pop(guard);
+    if (node==NULL)
+      return false;
+    Memory::HazardPointers::retire(node);
+    ValueDestroyer destroyer{node->value()};
+    item=std::move(*node->value());
+    return true;
+  }
+};
+
+}
@@ -1,14 +1,34 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <tuple>
+#include <type_traits>
 #include <utility>
-#include <list>
+
+// HashMap compares control bytes 32 (AVX2) or 16 (SSE2) at a time. Defining
+// MAPS_HASHMAP_SCALAR_PROBING selects the portable byte-by-byte fallback.
+#if defined(MAPS_HASHMAP_SCALAR_PROBING)
+#elif defined(__AVX2__)
+#define MAPS_HASHMAP_AVX2_PROBING
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MAPS_HASHMAP_SSE2_PROBING
+#include <emmintrin.h>
+#endif
 
 namespace Maps {
 
-template <typename KeyType, typename ValueType>
+// Hash and KeyEqual may declare is_transparent to allow lookups by any key
+// they accept, e.g. std::string_view for std::string keys. A Hash that declares
+// is_avalanching is trusted to spread its bits and is used without extra mixing.
+template <typename KeyType, typename ValueType, typename Hash = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>>
 class HashMap
 {
 public:
@@ -16,6 +36,8 @@ public:
   using mapped_type = ValueType;
   using value_type = std::pair<key_type, mapped_type>;
   using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
   using reference = value_type&;
   using const_reference = const value_type&;
 
@@ -25,21 +47,71 @@ public:
   using const_iterator = ConstIterator;
 
 private:
-  std::list <value_type> array[64007];
+  // Open addressing with SwissTable-style control bytes: a full slot keeps the
+  // low 7 bits of the hash, so most mismatches are rejected without touching the key.
+  // The table itself only stores positions into a dense entry array, which keeps
+  // iteration independent of the table size.
+  using control_type = signed char;
+  static constexpr control_type EMPTY = -128;
+  static constexpr control_type DELETED = -2;
+  static constexpr size_type MIN_CAPACITY = 8;
+
+  class Group;
+
+  control_type* control;//capacity bytes followed by a copy of the first Group::WIDTH-1
+  size_type* indices;//position in entries of the value held by each full slot
+  value_type* entries;//counter values in insertion order
+  size_type entryCapacity;//always maxLoad(capacity)
+  size_type capacity;//always zero or a power of two
   size_type counter;
-  size_type first, last;
-  const size_type maxSize;
+  size_type growthLeft;//empty slots that can still be filled before a rehash
+  float maxLoadFactor;
+  Hash hash;
+  KeyEqual keyEqual;
+
+  template <typename F, typename = void>
+  struct isTransparent : std::false_type {};
+  template <typename F>
+  struct isTransparent<F, typename std::conditional<true, void, typename F::is_transparent>::type> : std::true_type {};
+
+  template <typename F, typename = void>
+  struct isAvalanching : std::false_type {};
+  template <typename F>
+  struct isAvalanching<F, typename std::conditional<true, void, typename F::is_avalanching>::type> : std::true_type {};
+
+  template <typename K>
+  using transparentKey = typename std::enable_if<isTransparent<Hash>::value && isTransparent<KeyEqual>::value &&
+                                                 !std::is_convertible<const K&, const_iterator>::value>::type;
 public:
 
-  HashMap():maxSize(64007)
+  HashMap():control(NULL), indices(NULL), entries(NULL), entryCapacity(0), capacity(0), counter(0), growthLeft(0),
+           maxLoadFactor(0.875f)
+  {}
+
+  explicit HashMap(const Hash& hash, const KeyEqual& keyEqual=KeyEqual())
+    :control(NULL), indices(NULL), entries(NULL), entryCapacity(0), capacity(0), counter(0), growthLeft(0),
+     maxLoadFactor(0.875f), hash(hash), keyEqual(keyEqual)
+  {}
+
+  explicit HashMap(size_type expectedSize):HashMap()
   {
-    counter=0;
-    first=0;
-    last=0;
+    reserve(expectedSize);
+  }
+
+  // Sizes the table once, from the length of the range when it can be
+  // measured up front, otherwise from expectedSize.
+  template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+  HashMap(InputIt first, InputIt last, size_type expectedSize=0):HashMap()
+  {
+    size_type size=rangeSize(first, last, typename std::iterator_traits<InputIt>::iterator_category());
+    reserve(size>expectedSize ? size : expectedSize);
+    for (; first != last; ++first)
+      insert_or_assign((*first).first, (*first).second);
   }
 
   HashMap(std::initializer_list<value_type> list):HashMap()
   {
+    reserve(list.size());
     for (auto it = list.begin(); it != list.end(); ++it)
       (*this)[(*it).first]=(*it).second;
   }
@@ -49,190 +121,570 @@ public:
     *this = other;
   }
 
-  HashMap(HashMap&& other):maxSize(other.maxSize)
+  HashMap(HashMap&& other):HashMap()
   {
     *this = std::move(other);
   }
 
   HashMap& operator=(const HashMap& other)
   {
-  	if (*this==other)
-  		return *this;
-  	erase();
-  	first=other.first;
-  	last=other.last;
-  	ConstIterator itr(other);
-  	for (itr=other.begin();itr!=other.end();itr++)
-       (*this)[(*itr).first]=(*itr).second;
-  	return *this;
+    if (this==&other)
+      return *this;
+    erase();
+    hash=other.hash;
+    keyEqual=other.keyEqual;
+    maxLoadFactor=other.maxLoadFactor;
+    if (capacity!=other.capacity || entryCapacity!=other.entryCapacity)
+    {
+      releaseStorage();
+      allocateTable(other.capacity);
+      allocateEntries(other.entryCapacity);
+    }
+    for (;counter<other.counter;counter++)
+      new (entries+counter) value_type(other.entries[counter]);
+    for (size_type index=0;index<capacity;index++)
+    {
+      setControl(index, other.control[index]);
+      indices[index]=other.indices[index];
+    }
+    growthLeft=other.growthLeft;
+    return *this;
   }
 
   HashMap& operator=(HashMap&& other)
   {
-    if(array==other.array)
+    if (this==&other)
       return *this;
-  	counter=other.counter;
-  	first=other.first;
-  	last=other.last;
-  	for (size_type current=0;current<maxSize;current++)
-  		array[current]=std::move(other.array[current]);
-  	other.counter=0;
-  	return *this;
+    erase();
+    releaseStorage();
+    hash=std::move(other.hash);
+    keyEqual=std::move(other.keyEqual);
+    control=other.control;
+    indices=other.indices;
+    entries=other.entries;
+    entryCapacity=other.entryCapacity;
+    capacity=other.capacity;
+    counter=other.counter;
+    growthLeft=other.growthLeft;
+    maxLoadFactor=other.maxLoadFactor;
+
+    other.control=NULL;
+    other.indices=NULL;
+    other.entries=NULL;
+    other.entryCapacity=0;
+    other.capacity=0;
+    other.counter=0;
+    other.growthLeft=0;
+    return *this;
   }
 
   ~HashMap()
   {
-	  erase();
+    erase();
+    releaseStorage();
   }
 
 private:
-  size_type hashFunction(const key_type& key) const
+  static bool isFull(control_type c)
   {
-    std::hash<key_type> hash;
-    size_type hashedKey=hash(key);
-    hashedKey=hashedKey%maxSize;
-    return hashedKey;
+    return c>=0;
   }
-public:
 
-  bool isEmpty() const
+  // Full or deleted slots allowed before a rehash. Whatever the load factor,
+  // one slot in eight stays empty, because an empty slot is what ends a probe.
+  size_type maxLoad(size_type buckets) const
   {
-    return counter==0;
+    if (buckets==0)
+      return 0;
+    size_type limit=static_cast<size_type>(static_cast<double>(buckets)*maxLoadFactor);
+    if (limit>buckets-buckets/8)
+      limit=buckets-buckets/8;
+    if (limit==0)
+      limit=1;
+    return limit;
   }
 
-  mapped_type& operator[](const key_type& key)
+  size_type bucketsFor(size_type elements) const
+  {
+    if (elements==0)
+      return 0;
+    size_type buckets=MIN_CAPACITY;
+    while (maxLoad(buckets)<elements)
+      buckets*=2;
+    return buckets;
+  }
+
+  template <typename InputIt>
+  static size_type rangeSize(InputIt, InputIt, std::input_iterator_tag)
+  {
+    return 0;
+  }
+
+  template <typename ForwardIt>
+  static size_type rangeSize(ForwardIt first, ForwardIt last, std::forward_iterator_tag)
   {
-    Iterator itr(*this);
-    itr = find (key);
-    if (itr.it!=array[last].end())
-      return (*itr).second;
+    return static_cast<size_type>(std::distance(first, last));
+  }
+
+  template <typename K>
+  size_type hashFunction(const K& key) const
+  {
+    std::uint64_t hashedKey=hash(key);
+    if (isAvalanching<Hash>::value)
+      return static_cast<size_type>(hashedKey);
+    // std::hash is the identity for integers, so the bits are mixed before
+    // they are split into a probe start and a 7-bit fingerprint.
+    hashedKey^=hashedKey>>33;
+    hashedKey*=0xff51afd7ed558ccdULL;
+    hashedKey^=hashedKey>>33;
+    return static_cast<size_type>(hashedKey);
+  }
 
+  static size_type probeStart(size_type hashedKey)
+  {
+    return hashedKey>>7;
+  }
+
+  static control_type fingerprint(size_type hashedKey)
+  {
+    return static_cast<control_type>(hashedKey & 0x7F);
+  }
+
+  static size_type controlBytes(size_type buckets)
+  {
+    return buckets+Group::WIDTH-1;
+  }
+
+  void allocateEntries(size_type size)
+  {
+    entryCapacity=size;
+    entries=NULL;
+    if (size!=0)
+      entries=std::allocator<value_type>().allocate(size);
+  }
+
+  static void releaseEntries(value_type* block, size_type size)
+  {
+    if (size!=0)
+      std::allocator<value_type>().deallocate(block, size);
+  }
+
+  void allocateTable(size_type buckets)
+  {
+    capacity=buckets;
+    growthLeft=maxLoad(buckets);
+    if (buckets==0)
+      return;
+    control=new control_type[controlBytes(buckets)];
+    for (size_type index=0;index<controlBytes(buckets);index++)
+      control[index]=EMPTY;
+    indices=new size_type[buckets];
+  }
+
+  void releaseStorage()
+  {
+    if (capacity!=0)
+    {
+      delete[] control;
+      delete[] indices;
+    }
+    releaseEntries(entries, entryCapacity);
+    control=NULL;
+    indices=NULL;
+    entries=NULL;
+    entryCapacity=0;
+    capacity=0;
+    growthLeft=0;
+  }
+
+  // Keeps the cloned tail in sync, so a group loaded near the end of the
+  // table sees the slots it wraps around to. Tables smaller than a group
+  // are cloned several times over.
+  void setControl(size_type index, control_type c)
+  {
+    control[index]=c;
+    for (index+=capacity;index<controlBytes(capacity);index+=capacity)
+      control[index]=c;
+  }
+
+  // Probing walks whole groups in triangular steps, which visits every group
+  // of a power-of-two table. Only fingerprint hits reach the key comparison.
+  template <typename K>
+  size_type findSlot(const K& key) const
+  {
+    if (counter==0)
+      return capacity;
     size_type hashedKey=hashFunction(key);
-    value_type newOne(key, mapped_type());
-    array[hashedKey].push_front(newOne);
+    control_type print=fingerprint(hashedKey);
+    size_type mask=capacity-1;
+    size_type offset=probeStart(hashedKey)&mask;
+    for (size_type step=Group::WIDTH;;step+=Group::WIDTH)
+    {
+      Group group(control+offset);
+      for (auto hits=group.match(print);hits!=0;hits&=hits-1)
+      {
+        size_type index=(offset+Group::lowestBit(hits))&mask;
+        if (keyEqual(entries[indices[index]].first, key))
+          return index;
+      }
+      if (group.matchEmpty()!=0)
+        return capacity;
+      offset=(offset+step)&mask;
+    }
+  }
+
+  // Slot that points at the given entry; the entry must be in the map.
+  size_type findSlotOfEntry(size_type entry) const
+  {
+    size_type hashedKey=hashFunction(entries[entry].first);
+    control_type print=fingerprint(hashedKey);
+    size_type mask=capacity-1;
+    size_type offset=probeStart(hashedKey)&mask;
+    for (size_type step=Group::WIDTH;;step+=Group::WIDTH)
+    {
+      for (auto hits=Group(control+offset).match(print);hits!=0;hits&=hits-1)
+      {
+        size_type index=(offset+Group::lowestBit(hits))&mask;
+        if (indices[index]==entry)
+          return index;
+      }
+      offset=(offset+step)&mask;
+    }
+  }
+
+  // First slot on the probe sequence that is not full; there is always one,
+  // because growthLeft keeps at least one slot in eight empty.
+  size_type findInsertSlot(size_type hashedKey) const
+  {
+    size_type mask=capacity-1;
+    size_type offset=probeStart(hashedKey)&mask;
+    for (size_type step=Group::WIDTH;;step+=Group::WIDTH)
+    {
+      auto free=Group(control+offset).matchEmptyOrDeleted();
+      if (free!=0)
+        return (offset+Group::lowestBit(free))&mask;
+      offset=(offset+step)&mask;
+    }
+  }
+
+  // Moves to a table of the given size, which must fit counter entries;
+  // tombstones are dropped on the way.
+  void rebuild(size_type buckets)
+  {
+    control_type* oldControl=control;
+    size_type* oldIndices=indices;
+    size_type oldCapacity=capacity;
+    control=NULL;
+    indices=NULL;
+    allocateTable(buckets);
+    if (entryCapacity!=maxLoad(buckets))
+    {
+      value_type* oldEntries=entries;
+      size_type oldEntryCapacity=entryCapacity;
+      allocateEntries(maxLoad(buckets));
+      for (size_type entry=0;entry<counter;entry++)
+      {
+        new (entries+entry) value_type(std::move(oldEntries[entry]));
+        oldEntries[entry].~value_type();
+      }
+      releaseEntries(oldEntries, oldEntryCapacity);
+    }
+    for (size_type entry=0;entry<counter;entry++)
+    {
+      size_type hashedKey=hashFunction(entries[entry].first);
+      size_type target=findInsertSlot(hashedKey);
+      setControl(target, fingerprint(hashedKey));
+      indices[target]=entry;
+      growthLeft--;
+    }
+    if (oldCapacity!=0)
+    {
+      delete[] oldControl;
+      delete[] oldIndices;
+    }
+  }
+
+  // Looks the key up and, if it is missing, reserves the slot it should be
+  // inserted in. The caller constructs entries[counter] and then calls commitInsert().
+  std::pair<size_type, bool> findOrPrepareInsert(const key_type& key, size_type hashedKey)
+  {
+    control_type print=fingerprint(hashedKey);
+    size_type target=capacity;
+    if (capacity!=0)
+    {
+      size_type mask=capacity-1;
+      size_type offset=probeStart(hashedKey)&mask;
+      for (size_type step=Group::WIDTH;;step+=Group::WIDTH)
+      {
+        Group group(control+offset);
+        for (auto hits=group.match(print);hits!=0;hits&=hits-1)
+        {
+          size_type index=(offset+Group::lowestBit(hits))&mask;
+          if (keyEqual(entries[indices[index]].first, key))
+            return std::make_pair(index, false);
+        }
+        auto free=group.matchEmptyOrDeleted();
+        if (free!=0 && target==capacity)
+          target=(offset+Group::lowestBit(free))&mask;
+        if (group.matchEmpty()!=0)
+          break;
+        offset=(offset+step)&mask;
+      }
+      if (control[target]==DELETED || growthLeft>0)
+        return std::make_pair(target, true);
+    }
+    if (capacity==0)
+      rebuild(MIN_CAPACITY);
+    else if (counter+1>maxLoad(capacity)/2)
+      rebuild(2*capacity);
+    else
+      rebuild(capacity);//only tombstones are in the way
+    return std::make_pair(findInsertSlot(hashedKey), true);
+  }
+
+  void commitInsert(size_type index, size_type hashedKey)
+  {
+    if (control[index]==EMPTY)
+      growthLeft--;
+    setControl(index, fingerprint(hashedKey));
+    indices[index]=counter;
     counter++;
-     if (counter==1)
-     {
-       first=hashedKey;
-       last=hashedKey;
-     }
-     else
-     {
-       if(hashedKey<first)
-          first=hashedKey;
-       if(hashedKey>last)
-          last=hashedKey;
-     }
-     return array[hashedKey].front().second;
   }
 
-  const mapped_type& valueOf(const key_type& key) const
+  template <typename K>
+  size_type findEntry(const K& key) const
+  {
+    size_type index=findSlot(key);
+    if (index==capacity)
+      return counter;
+    return indices[index];
+  }
+
+  template <typename K>
+  size_type existingEntry(const K& key) const
   {
     if (counter==0)
       throw std::out_of_range ("Calling valueOf() when the map is empty");
 
-    Iterator valueIt = find(key);
-    if (valueIt.it==array[last].end())
+    size_type entry=findEntry(key);
+    if (entry==counter)
       throw std::out_of_range ("Calling valueOf() with nonexisting key");
 
-    return (*valueIt).second;
+    return entry;
   }
 
-  mapped_type& valueOf(const key_type& key)
+  template <typename K>
+  void removeKey(const K& key)
   {
-    if (counter==0)
-      throw std::out_of_range ("Calling valueOf() when the map is empty");
+    size_type index=findSlot(key);
+    if (index==capacity)
+      throw std::out_of_range ("Removal of nonexisting node");
+    removeAt(index);
+  }
 
-    Iterator valueIt = find(key);
-    if (valueIt.it==array[last].end())
-      throw std::out_of_range ("Calling valueOf() with nonexisting key");
+  iterator iteratorAt(size_type entry)
+  {
+    Iterator toReturn(*this);
+    toReturn.current=entry;
+    return toReturn;
+  }
 
-    return (*valueIt).second;
+  // Single probe: the mapped value is only constructed, from args, when the key is new.
+  template <typename KArg, typename... Args>
+  std::pair<size_type, bool> emplaceKey(KArg&& key, Args&&... args)
+  {
+    size_type hashedKey=hashFunction(key);
+    auto slot=findOrPrepareInsert(key, hashedKey);
+    if (!slot.second)
+      return std::make_pair(indices[slot.first], false);
+    new (entries+counter) value_type(std::piecewise_construct,
+                                     std::forward_as_tuple(std::forward<KArg>(key)),
+                                     std::forward_as_tuple(std::forward<Args>(args)...));
+    commitInsert(slot.first, hashedKey);
+    return std::make_pair(counter-1, true);
   }
 
-  const_iterator find(const key_type& key) const
+  template <typename KArg, typename M>
+  std::pair<size_type, bool> assignKey(KArg&& key, M&& value)
   {
     size_type hashedKey=hashFunction(key);
-    ConstIterator toReturn(*this);
+    auto slot=findOrPrepareInsert(key, hashedKey);
+    if (!slot.second)
+    {
+      entries[indices[slot.first]].second=std::forward<M>(value);
+      return std::make_pair(indices[slot.first], false);
+    }
+    new (entries+counter) value_type(std::forward<KArg>(key), std::forward<M>(value));
+    commitInsert(slot.first, hashedKey);
+    return std::make_pair(counter-1, true);
+  }
 
-    for (toReturn.it=array[hashedKey].begin();toReturn.it!=array[hashedKey].end();toReturn.it++)
+  // Frees the slot and fills the hole in entries with the last entry, so the
+  // entries stay dense.
+  void removeAt(size_type index)
+  {
+    size_type entry=indices[index];
+    size_type lastEntry=counter-1;
+    // If the run of non-empty slots around this one is shorter than a group,
+    // no probe can have passed over it while it was full, so no tombstone is needed.
+    size_type before=(index-Group::WIDTH)&(capacity-1);
+    auto emptyAfter=Group(control+index).matchEmpty();
+    auto emptyBefore=Group(control+before).matchEmpty();
+    if (emptyAfter!=0 && emptyBefore!=0 &&
+        Group::lowestBit(emptyAfter)+Group::WIDTH-1-Group::highestBit(emptyBefore)<Group::WIDTH)
     {
-      if((*(toReturn.it)).first==key)
-        {
-          toReturn.current=hashedKey;
-          return toReturn;
-        }
+      setControl(index, EMPTY);
+      growthLeft++;
+    }
+    else
+      setControl(index, DELETED);
+
+    entries[entry].~value_type();
+    if (entry!=lastEntry)
+    {
+      indices[findSlotOfEntry(lastEntry)]=entry;
+      new (entries+entry) value_type(std::move(entries[lastEntry]));
+      entries[lastEntry].~value_type();
     }
-    toReturn.it=array[last].end();
-    toReturn.current=last;
+    counter--;
+  }
+public:
+
+  bool isEmpty() const
+  {
+    return counter==0;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    size_type entry=emplaceKey(key).first;
+    return entries[entry].second;
+  }
+
+  mapped_type& operator[](key_type&& key)
+  {
+    size_type entry=emplaceKey(std::move(key)).first;
+    return entries[entry].second;
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+  {
+    auto result=emplaceKey(key, std::forward<Args>(args)...);
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+  {
+    auto result=emplaceKey(std::move(key), std::forward<Args>(args)...);
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  // The key is needed before probing, so the pair is built first and moved
+  // into the map only if its key is new.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args)
+  {
+    value_type element(std::forward<Args>(args)...);
+    auto result=emplaceKey(std::move(element.first), std::move(element.second));
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value)
+  {
+    auto result=assignKey(key, std::forward<M>(value));
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value)
+  {
+    auto result=assignKey(std::move(key), std::forward<M>(value));
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    return entries[existingEntry(key)].second;
+  }
+
+  mapped_type& valueOf(const key_type& key)
+  {
+    return entries[existingEntry(key)].second;
+  }
+
+  template <typename K, typename = transparentKey<K>>
+  const mapped_type& valueOf(const K& key) const
+  {
+    return entries[existingEntry(key)].second;
+  }
+
+  template <typename K, typename = transparentKey<K>>
+  mapped_type& valueOf(const K& key)
+  {
+    return entries[existingEntry(key)].second;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    ConstIterator toReturn(*this);
+    toReturn.current=findEntry(key);
     return toReturn;
   }
 
   iterator find(const key_type& key)
   {
-    size_type hashedKey=hashFunction(key);
     Iterator toReturn(*this);
+    toReturn.current=findEntry(key);
+    return toReturn;
+  }
 
-    for (toReturn.it=array[hashedKey].begin();toReturn.it!=array[hashedKey].end();toReturn.it++)
-    {
-      if((*(toReturn.it)).first==key)
-        {
-          toReturn.current=hashedKey;
-          return toReturn;
-        }
-    }
-    toReturn.it=array[last].end();
-    toReturn.current=last;
+  template <typename K, typename = transparentKey<K>>
+  const_iterator find(const K& key) const
+  {
+    ConstIterator toReturn(*this);
+    toReturn.current=findEntry(key);
+    return toReturn;
+  }
+
+  template <typename K, typename = transparentKey<K>>
+  iterator find(const K& key)
+  {
+    Iterator toReturn(*this);
+    toReturn.current=findEntry(key);
     return toReturn;
   }
 
   void remove(const key_type& key)
   {
-    auto itr = find (key);
-    if (itr.it==array[last].end())
-      throw std::out_of_range ("Removal of nonexisting node");
-    size_type hashedKey=hashFunction(key);
-    typename std::list<value_type>::iterator a;
-    for (a=array[hashedKey].begin();(*a).first!=key;a++){}
-
-    array[hashedKey].erase(a);
-  	counter--;
-  	itr.it=array[hashedKey].begin();
-  	if (isEmpty())
-  	{
-  		last=0;
-  		first=0;
-  		return;
-  	}
-  	if (hashedKey==last && array[hashedKey].empty())
-  	{
-  		itr--;
-  		while (array[itr.current].empty())
-  			itr--;
-  		last=itr.current;
-  		return;
-  	}
-
-  	if (hashedKey==first && array[hashedKey].empty())
-  	{
-  		itr++;
-  		while (array[itr.current].empty())
-  			itr++;
-  		first=itr.current;
-  		return;
-  	}
+    removeKey(key);
   }
 
+  template <typename K, typename = transparentKey<K>>
+  void remove(const K& key)
+  {
+    removeKey(key);
+  }
 
+  // The last entry is moved into the removed one's place, so iterators to
+  // the last entry are invalidated.
   void remove(const const_iterator& itr)
   {
-    remove((*(itr.it)).first);
+    if (itr.current>=counter)
+      throw std::out_of_range ("Removal of nonexisting node");
+    removeAt(findSlotOfEntry(itr.current));
   }
 
   void erase()
   {
-	for (iterator itr=begin();getSize()!=0;itr=begin())
-		remove(itr);
+    for (size_type entry=0;entry<counter;entry++)
+      entries[entry].~value_type();
+    for (size_type index=0;capacity!=0 && index<controlBytes(capacity);index++)
+      control[index]=EMPTY;
+    counter=0;
+    growthLeft=maxLoad(capacity);
   }
 
   size_type getSize() const
@@ -240,17 +692,68 @@ public:
     return counter;
   }
 
+  size_type bucket_count() const
+  {
+    return capacity;
+  }
+
+  float load_factor() const
+  {
+    if (capacity==0)
+      return 0;
+    return static_cast<float>(counter)/capacity;
+  }
+
+  float max_load_factor() const
+  {
+    return maxLoadFactor;
+  }
+
+  // Factors above 0.875 behave like 0.875, the most the probing allows.
+  void max_load_factor(float factor)
+  {
+    if (!(factor>0))
+      throw std::out_of_range ("max_load_factor() must be positive");
+    maxLoadFactor=factor;
+    if (capacity!=0)
+      rebuild(bucketsFor(counter)>capacity ? bucketsFor(counter) : capacity);
+  }
+
+  // Makes room for the given number of entries without further rehashing.
+  void reserve(size_type size)
+  {
+    if (bucketsFor(size)>capacity)
+      rebuild(bucketsFor(size));
+  }
+
+  // Sets the table to at least the given number of buckets, rounded up to a
+  // power of two, and never below what the current entries need.
+  void rehash(size_type buckets)
+  {
+    size_type target=bucketsFor(counter);
+    if (buckets!=0 && target<MIN_CAPACITY)
+      target=MIN_CAPACITY;
+    while (target<buckets)
+      target*=2;
+    if (target!=capacity)
+      rebuild(target);
+  }
+
+  void shrink_to_fit()
+  {
+    rehash(0);
+  }
+
   bool operator==(const HashMap& other) const
   {
     if (counter!=other.counter)
       return 0;
 
-    auto itThis=begin();
     for (auto itr=other.begin(); itr!=other.end();itr++)
       {
-        if (*(itr.it) != *(itThis.it))
+        size_type entry=findEntry((*itr).first);
+        if (entry==counter || entries[entry].second != (*itr).second)
           return 0;
-        itThis++;
       }
       return 1;
   }
@@ -263,32 +766,28 @@ public:
   iterator begin()
   {
     Iterator toReturn(*this);
-    toReturn.it=array[first].begin();
-    toReturn.current=first;
+    toReturn.current=0;
     return toReturn;
   }
 
   iterator end()
   {
     Iterator toReturn(*this);
-    toReturn.it=array[last].end();
-    toReturn.current=last;
+    toReturn.current=counter;
     return toReturn;
   }
 
   const_iterator cbegin() const
   {
     ConstIterator toReturn(*this);
-    toReturn.it=array[first].begin();
-    toReturn.current=first;
+    toReturn.current=0;
     return toReturn;
   }
 
   const_iterator cend() const
   {
     ConstIterator toReturn(*this);
-    toReturn.it=array[last].end();
-    toReturn.current=last;
+    toReturn.current=counter;
     return toReturn;
   }
 
@@ -303,44 +802,130 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::ConstIterator
+// Compares a group of control bytes against one value at a time and returns
+// a bitmask with bit i set when byte i matched.
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+class HashMap<KeyType, ValueType, Hash, KeyEqual>::Group
 {
 public:
-  friend HashMap<KeyType, ValueType>;
+#if defined(MAPS_HASHMAP_AVX2_PROBING)
+  static constexpr size_type WIDTH = 32;
+#else
+  static constexpr size_type WIDTH = 16;
+#endif
+  using mask_type = std::uint32_t;
+
+private:
+#if defined(MAPS_HASHMAP_AVX2_PROBING)
+  __m256i bytes;
+#elif defined(MAPS_HASHMAP_SSE2_PROBING)
+  __m128i bytes;
+#else
+  const control_type* bytes;
+#endif
+
+public:
+  explicit Group(const control_type* position)
+  {
+#if defined(MAPS_HASHMAP_AVX2_PROBING)
+    bytes=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(position));
+#elif defined(MAPS_HASHMAP_SSE2_PROBING)
+    bytes=_mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+#else
+    bytes=position;
+#endif
+  }
+
+  mask_type match(control_type c) const
+  {
+#if defined(MAPS_HASHMAP_AVX2_PROBING)
+    return static_cast<mask_type>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c))));
+#elif defined(MAPS_HASHMAP_SSE2_PROBING)
+    return static_cast<mask_type>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c))));
+#else
+    mask_type result=0;
+    for (size_type index=0;index<WIDTH;index++)
+      if (bytes[index]==c)
+        result|=mask_type(1)<<index;
+    return result;
+#endif
+  }
+
+  mask_type matchEmpty() const
+  {
+    return match(EMPTY);
+  }
+
+  // Empty and deleted are the only control values with the sign bit set.
+  mask_type matchEmptyOrDeleted() const
+  {
+#if defined(MAPS_HASHMAP_AVX2_PROBING)
+    return static_cast<mask_type>(_mm256_movemask_epi8(bytes));
+#elif defined(MAPS_HASHMAP_SSE2_PROBING)
+    return static_cast<mask_type>(_mm_movemask_epi8(bytes));
+#else
+    mask_type result=0;
+    for (size_type index=0;index<WIDTH;index++)
+      if (bytes[index]<0)
+        result|=mask_type(1)<<index;
+    return result;
+#endif
+  }
+
+  static size_type lowestBit(mask_type mask)
+  {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    size_type bit=0;
+    while ((mask&1)==0)
+    {
+      mask>>=1;
+      bit++;
+    }
+    return bit;
+#endif
+  }
+
+  static size_type highestBit(mask_type mask)
+  {
+#if defined(__GNUC__)
+    return 31-__builtin_clz(mask);
+#else
+    size_type bit=0;
+    while (mask>>=1)
+      bit++;
+    return bit;
+#endif
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+class HashMap<KeyType, ValueType, Hash, KeyEqual>::ConstIterator
+{
+public:
+  friend HashMap;
   using reference = typename HashMap::const_reference;
   using iterator_category = std::bidirectional_iterator_tag;
   using value_type = typename HashMap::value_type;
   using pointer = const typename HashMap::value_type*;
 
-  typename std::list<value_type>::const_iterator it;
-  size_type current;
-  const HashMap<KeyType, ValueType>& container;
+  size_type current;//position in the container's entries
+  const HashMap& container;
 
 
-  explicit ConstIterator( const HashMap<KeyType, ValueType>& container)
-                        :it(container.array[0].begin()), current(0), container(container){}
+  explicit ConstIterator( const HashMap& container)
+                        :current(container.counter), container(container){}
 
   ConstIterator(const ConstIterator& other)
-                :it(other.it), current(other.current), container(other.container){}
+                :current(other.current), container(other.container){}
 
   ConstIterator& operator++()
   {
-    if (it == container.array[container.last].end())
+    if (current >= container.counter)
       throw std::out_of_range("Iterator++");
 
-    it++;
-    if (it==container.array[container.last].end())
-      return *this;
-
-    if (it==container.array[current].end())
-      {
-        current++;
-        while(container.array[current].empty())
-          current++;
-        it=container.array[current].begin();
-      }
-
+    current++;
     return *this;
   }
 
@@ -351,19 +936,10 @@ public:
 
   ConstIterator& operator--()
   {
-    if (it == container.array[container.first].begin())
+    if (current == 0)
       throw std::out_of_range("Iterator--");
 
-    if (it==container.array[current].begin())
-      {
-        current--;
-        while(container.array[current].empty())
-          current--;
-        it=--container.array[current].end();
-      }
-      else
-        it--;
-
+    current--;
     return *this;
   }
 
@@ -374,21 +950,21 @@ public:
 
   reference operator*() const
   {
-    if (container.counter==0 || it==container.array[current].end())
+    if (current>=container.counter)
 		  throw std::out_of_range ("Operator *");
-    return *it;
+    return container.entries[current];
   }
 
   pointer operator->() const
   {
-    if (container.counter==0 || it==container.array[current].end())
+    if (current>=container.counter)
 		  throw std::out_of_range ("Operator ->");
     return &this->operator*();
   }
 
   bool operator==(const ConstIterator& other) const
   {
-    return it == other.it;
+    return current == other.current;
   }
 
   bool operator!=(const ConstIterator& other) const
@@ -400,22 +976,21 @@ public:
   {
       if( & other != this )
       {
-          it=other.it;
           current=other.current;
       }
       return * this;
   }
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::Iterator : public HashMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+class HashMap<KeyType, ValueType, Hash, KeyEqual>::Iterator : public HashMap<KeyType, ValueType, Hash, KeyEqual>::ConstIterator
 {
 public:
   using reference = typename HashMap::reference;
   using pointer = typename HashMap::value_type*;
 
 
-  explicit Iterator(HashMap<KeyType, ValueType>& container)
+  explicit Iterator(HashMap& container)
                     :ConstIterator(container)
   {}
 
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+namespace Memory {
+
+// Safe reclamation for lock-free containers. A thread publishes the nodes
+// it is about to read in hazard slots; a node removed from a container is
+// retired instead of deleted, and freed once no slot names it.
+//
+// Every thread gets a record of SLOTS_PER_THREAD slots on first use, which
+// goes back to the pool when the thread exits. Retired nodes are kept per
+// thread and scanned in batches; those still protected when their thread
+// exits are handed to whichever thread scans next.
+class HazardPointers
+{
+public:
+  static constexpr std::size_t SLOTS_PER_THREAD = 4;
+
+private:
+  struct alignas(64) Record
+  {
+    std::atomic<const void*> hazards[SLOTS_PER_THREAD];
+    std::atomic<bool> active;
+    Record* next;
+    void* memory;//what createRecord() allocated
+
+    Record() : active(true), next(NULL), memory(NULL)
+    {
+      for (auto& hazard : hazards)
+        hazard.store(NULL, std::memory_order_relaxed);
+    }
+  };
+
+  struct Retired
+  {
+    void* pointer;
+    void (*deleter)(void*);
+  };
+
+  // Records are only reused, never freed before exit, so scans can walk the
+  // list without synchronising with exiting threads.
+  struct Registry
+  {
+    std::atomic<Record*> records;
+    std::atomic<std::size_t> recordCount;
+    std::mutex orphansLock;
+    std::vector<Retired> orphans;
+
+    Registry() : records(NULL), recordCount(0)
+    {}
+
+    ~Registry()
+    {
+      for (Retired& retired : orphans)
+        retired.deleter(retired.pointer);
+      Record* record=records.load();
+      while (record!=NULL)
+      {
+        Record* next=record->next;
+        destroyRecord(record);
+        record=next;
+      }
+    }
+  };
+
+  struct ThreadState
+  {
+    Record* record;
+    std::size_t used;
+    std::vector<Retired> retired;
+
+    ThreadState() : record(acquireRecord()), used(0)
+    {}
+
+    ~ThreadState()
+    {
+      scan(*this);
+      if (!retired.empty())
+      {
+        std::lock_guard<std::mutex> lock(registry().orphansLock);
+        registry().orphans.insert(registry().orphans.end(), retired.begin(), retired.end());
+      }
+      record->active.store(false, std::memory_order_release);
+    }
+  };
+
+  // Records are over-aligned, which plain new only honours from C++17 on.
+  static Record* createRecord()
+  {
+    std::size_t space=sizeof(Record)+alignof(Record);
+    void* memory=::operator new(space);
+    void* aligned=memory;
+    std::align(alignof(Record), sizeof(Record), aligned, space);
+    Record* record=new (aligned) Record;
+    record->memory=memory;
+    return record;
+  }
+
+  static void destroyRecord(Record* record)
+  {
+    void* memory=record->memory;
+    record->~Record();
+    ::operator delete(memory);
+  }
+
+  static Registry& registry()
+  {
+    static Registry instance;
+    return instance;
+  }
+
+  static ThreadState& threadState()
+  {
+    thread_local ThreadState state;
+    return state;
+  }
+
+  static Record* acquireRecord()
+  {
+    Registry& reg=registry();
+    for (Record* record=reg.records.load(std::memory_order_acquire);record!=NULL;record=record->next)
+    {
+      bool expected=false;
+      if (!record->active.load(std::memory_order_relaxed) &&
+          record->active.compare_exchange_strong(expected, true, std::memory_order_acquire))
+        return record;
+    }
+    Record* record=createRecord();
+    record->next=reg.records.load(std::memory_order_relaxed);
+    while (!reg.records.compare_exchange_weak(record->next, record, std::memory_order_release,
+                                              std::memory_order_relaxed))
+    {}
+    reg.recordCount.fetch_add(1, std::memory_order_relaxed);
+    return record;
+  }
+
+  // Frees every retired node that no hazard slot currently names.
+  static void scan(ThreadState& state)
+  {
+    Registry& reg=registry();
+    {
+      std::unique_lock<std::mutex> lock(reg.orphansLock, std::try_to_lock);
+      if (lock.owns_lock() && !reg.orphans.empty())
+      {
+        state.retired.insert(state.retired.end(), reg.orphans.begin(), reg.orphans.end());
+        reg.orphans.clear();
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::vector<const void*> hazards;
+    for (Record* record=reg.records.load(std::memory_order_acquire);record!=NULL;record=record->next)
+      for (auto& hazard : record->hazards)
+      {
+        const void* pointer=hazard.load(std::memory_order_acquire);
+        if (pointer!=NULL)
+          hazards.push_back(pointer);
+      }
+    std::sort(hazards.begin(), hazards.end());
+
+    std::vector<Retired> kept;
+    for (Retired& retired : state.retired)
+      if (std::binary_search(hazards.begin(), hazards.end(), static_cast<const void*>(retired.pointer)))
+        kept.push_back(retired);
+      else
+        retired.deleter(retired.pointer);
+    state.retired.swap(kept);
+  }
+
+  template <typename Type>
+  static void deleteObject(void* pointer)
+  {
+    delete static_cast<Type*>(pointer);
+  }
+
+public:
+  // Holds one hazard slot of the calling thread. Guards must be destroyed
+  // in the reverse order of their creation, as block scoping does.
+  class Guard
+  {
+    std::atomic<const void*>* slot;
+
+  public:
+    Guard()
+    {
+      ThreadState& state=threadState();
+      if (state.used==SLOTS_PER_THREAD)
+        throw std::logic_error("All hazard slots of this thread are in use");
+      slot=&state.record->hazards[state.used];
+      state.used++;
+    }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+    ~Guard()
+    {
+      slot->store(NULL, std::memory_order_release);
+      threadState().used--;
+    }
+
+    // Loads source and publishes the pointer until it is known that source
+    // still held it after publication, so it cannot have been freed since.
+    template <typename Type>
+    Type* protect(const std::atomic<Type*>& source)
+    {
+      Type* pointer=source.load(std::memory_order_relaxed);
+      for (;;)
+      {
+        slot->store(pointer, std::memory_order_seq_cst);
+        Type* current=source.load(std::memory_order_seq_cst);
+        if (current==pointer)
+          return pointer;
+        pointer=current;
+      }
+    }
+
+    void reset()
+    {
+      slot->store(NULL, std::memory_order_release);
+    }
+  };
+
+  // Deletes pointer once no hazard slot names it; it must already be
+  // unreachable for threads that have not protected it yet.
+  template <typename Type>
+  static void retire(Type* pointer)
+  {
+    ThreadState& state=threadState();
+    state.retired.push_back(Retired{pointer, &deleteObject<Type>});
+    std::size_t threshold=2*SLOTS_PER_THREAD*registry().recordCount.load(std::memory_order_relaxed);
+    if (state.retired.size()>=std::max<std::size_t>(threshold, 64))
+      scan(state);
+  }
+};
+
+}
@@ -0,0 +1,473 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Defining LINEAR_CHECKED_ITERATORS to 1 makes every hook remember the list
+// it is in, so that IntrusiveList::erase, iteratorTo and insert throw
+// std::logic_error for an object or position of another list. By default
+// only membership in some list is checked. As with Vector, the setting
+// changes the layout of the hooks: every translation unit of a program must
+// use the same value.
+#if !defined(LINEAR_CHECKED_ITERATORS)
+#define LINEAR_CHECKED_ITERATORS 0
+#endif
+
+namespace Linear
+{
+
+template <typename Type, typename Tag>
+class IntrusiveList;
+
+// Links an object inherits so that it can sit in an IntrusiveList:
+//
+//   struct Connection : IntrusiveListHook<> { ... };
+//   IntrusiveList<Connection> idle;
+//
+// An object that must be in several lists at once inherits one hook per
+// list, told apart by tag types: an Entry deriving IntrusiveListHook<ByAge>
+// goes into IntrusiveList<Entry, ByAge>. Copying an object does not copy its
+// membership: a copied hook starts unlinked, and assigning to a hook leaves
+// it as it is.
+template <typename Tag = void>
+class IntrusiveListHook
+{
+  IntrusiveListHook* next;
+  IntrusiveListHook* prev;
+#if LINEAR_CHECKED_ITERATORS
+  const void* list;
+#endif
+
+  template <typename Type, typename ListTag>
+  friend class IntrusiveList;
+
+public:
+  IntrusiveListHook() : next(NULL), prev(NULL)
+#if LINEAR_CHECKED_ITERATORS
+    , list(NULL)
+#endif
+  {}
+
+  IntrusiveListHook(const IntrusiveListHook&) : IntrusiveListHook()
+  {}
+
+  IntrusiveListHook& operator=(const IntrusiveListHook&)
+  {
+    return *this;
+  }
+
+  bool isLinked() const
+  {
+    return next!=NULL;
+  }
+};
+
+// List of objects that already live elsewhere; the links are the
+// IntrusiveListHook<Tag> that Type derives from, so nothing is allocated or
+// copied. An object can be in one list per hook it has, and must outlive its
+// stay in the list or be erased first. The list never owns its objects:
+// erasing only unlinks.
+template <typename Type, typename Tag = void>
+class IntrusiveList
+{
+public:
+  using difference_type = std::ptrdiff_t;
+  using size_type = std::size_t;
+  using value_type = Type;
+  using pointer = Type*;
+  using reference = Type&;
+  using const_pointer = const Type*;
+  using const_reference = const Type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  using Hook = IntrusiveListHook<Tag>;
+
+  static_assert(std::is_base_of<Hook, Type>::value, "Type must derive from IntrusiveListHook<Tag>");
+
+  // Same layout as LinkedList: head->prev is NULL and the guard is the only
+  // hook whose next is NULL.
+  Hook* head;
+  Hook guard;
+  size_type counter;
+
+public:
+  IntrusiveList() : head(&guard), counter(0)
+  {}
+
+  IntrusiveList(const IntrusiveList&) = delete;
+  IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+  IntrusiveList(IntrusiveList&& other) : IntrusiveList()
+  {
+    *this=std::move(other);
+  }
+
+  ~IntrusiveList()
+  {
+    unlinkAll();
+  }
+
+  IntrusiveList& operator=(IntrusiveList&& other)
+  {
+    if (this==&other)
+      return *this;
+    unlinkAll();
+    if (other.isEmpty())
+      return *this;
+    head=other.head;
+    guard.prev=other.guard.prev;
+    guard.prev->next=&guard;
+    counter=other.counter;
+#if LINEAR_CHECKED_ITERATORS
+    for (Hook* node=head;node!=&guard;node=node->next)
+      node->list=this;
+#endif
+
+    other.head=&other.guard;
+    other.guard.prev=NULL;
+    other.counter=0;
+    return *this;
+  }
+
+private:
+  static Hook* hookOf(Type& item)
+  {
+    return static_cast<Hook*>(&item);
+  }
+
+  // Every hook but the guard is the base of a Type.
+  static Type* ownerOf(Hook* hook)
+  {
+    return static_cast<Type*>(hook);
+  }
+
+  // Throws unless node is linked, and with checks on, linked into this list.
+  void checkMember(const Hook* node) const
+  {
+    if (!node->isLinked())
+      throw std::logic_error("The object is not in a list");
+#if LINEAR_CHECKED_ITERATORS
+    if (node->list!=this)
+      throw std::logic_error("The object is in another list");
+#endif
+  }
+
+  // Links node in front of position, which may be the head or the guard.
+  void linkBefore(Hook* position, Hook* node)
+  {
+    if (node->isLinked())
+      throw std::logic_error("An attempt to link an object that already is in a list was made");
+#if LINEAR_CHECKED_ITERATORS
+    if (position!=&guard)
+      checkMember(position);
+    node->list=this;
+#endif
+    node->next=position;
+    node->prev=position->prev;
+    if (position==head)
+      head=node;
+    else
+      position->prev->next=node;
+    position->prev=node;
+    counter++;
+  }
+
+  void unlink(Hook* node)
+  {
+    if (node==head)
+    {
+      head=node->next;
+      head->prev=NULL;
+    }
+    else
+    {
+      node->prev->next=node->next;
+      node->next->prev=node->prev;
+    }
+    node->next=NULL;
+    node->prev=NULL;
+#if LINEAR_CHECKED_ITERATORS
+    node->list=NULL;
+#endif
+    counter--;
+  }
+
+  void unlinkAll()
+  {
+    while (head!=&guard)
+    {
+      Hook* next=head->next;
+      head->next=NULL;
+      head->prev=NULL;
+#if LINEAR_CHECKED_ITERATORS
+      head->list=NULL;
+#endif
+      head=next;
+    }
+    guard.prev=NULL;
+    counter=0;
+  }
+
+public:
+  bool isEmpty() const
+  {
+    return head==&guard;
+  }
+
+  size_type getSize() const
+  {
+    return counter;
+  }
+
+  void append(Type& item)
+  {
+    linkBefore(&guard, hookOf(item));
+  }
+
+  void prepend(Type& item)
+  {
+    linkBefore(head, hookOf(item));
+  }
+
+  void insert(const const_iterator& insertPosition, Type& item)
+  {
+    linkBefore(insertPosition.current, hookOf(item));
+  }
+
+  Type& popFirst()
+  {
+    if (isEmpty()) throw std::out_of_range("An attempt to pop first element from empty list was made");
+    Hook* node=head;
+    unlink(node);
+    return *ownerOf(node);
+  }
+
+  Type& popLast()
+  {
+    if (isEmpty()) throw std::out_of_range("An attempt to pop last element from empty list was made");
+    Hook* node=guard.prev;
+    unlink(node);
+    return *ownerOf(node);
+  }
+
+  void erase(const const_iterator& position)
+  {
+    if (position.current==&guard) throw std::out_of_range("An attempt to erase data at guard adress");
+#if LINEAR_CHECKED_ITERATORS
+    checkMember(position.current);
+#endif
+    unlink(position.current);
+  }
+
+  void erase(const const_iterator& firstIncluded, const const_iterator& lastExcluded)
+  {
+#if LINEAR_CHECKED_ITERATORS
+    if (firstIncluded.current!=&guard)
+      checkMember(firstIncluded.current);
+    if (lastExcluded.current!=&guard)
+      checkMember(lastExcluded.current);
+#endif
+    Hook* node=firstIncluded.current;
+    while (node!=lastExcluded.current)
+    {
+      if (node==&guard)
+        throw std::out_of_range("An attempt to erase data at guard adress");
+      Hook* next=node->next;
+      unlink(node);
+      node=next;
+    }
+  }
+
+  // Unlinks item in O(1). item must be in this list; only with
+  // LINEAR_CHECKED_ITERATORS is an item of another list caught.
+  void erase(Type& item)
+  {
+    Hook* node=hookOf(item);
+    checkMember(node);
+    unlink(node);
+  }
+
+  // Iterator to item, which must be in this list.
+  iterator iteratorTo(Type& item)
+  {
+    checkMember(hookOf(item));
+    Iterator it;
+    it.current=hookOf(item);
+    return it;
+  }
+
+  iterator begin()
+  {
+    Iterator it;
+    it.current=head;
+    return it;
+  }
+
+  iterator end()
+  {
+    Iterator it;
+    it.current=&guard;
+    return it;
+  }
+
+  const_iterator cbegin() const
+  {
+    ConstIterator it;
+    it.current=head;
+    return it;
+  }
+
+  const_iterator cend() const
+  {
+    ConstIterator it;
+    it.current=const_cast<Hook*>(&guard);
+    return it;
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Type, typename Tag>
+class IntrusiveList<Type, Tag>::ConstIterator
+{
+  friend IntrusiveList<Type, Tag>;
+public:
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename IntrusiveList::value_type;
+  using difference_type = typename IntrusiveList::difference_type;
+  using pointer = typename IntrusiveList::const_pointer;
+  using reference = typename IntrusiveList::const_reference;
+
+private:
+  Hook* current;
+public:
+
+  ConstIterator()
+  {
+    current=NULL;
+  }
+
+  reference operator*() const
+  {
+    if(current->next==NULL)//iterator points at the guard
+      throw std::out_of_range("Pointer points on the guard");
+    return *ownerOf(current);
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  ConstIterator& operator++()
+  {
+    if (current->next==NULL)//iterator points at the guard
+      throw std::out_of_range("Cannot increase iterator");
+    current=current->next;
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto result = *this;
+    ++(*this);
+    return result;
+  }
+
+  ConstIterator& operator--()
+  {
+    if (current->prev==NULL)
+        throw std::out_of_range("Cannot decrease iterator");
+    current=current->prev;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto result = *this;
+    --(*this);
+    return result;
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return current==other.current;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return current!=other.current;
+  }
+};
+/////////////////////////////////////////////////////////////////////////
+
+template <typename Type, typename Tag>
+class IntrusiveList<Type, Tag>::Iterator : public IntrusiveList<Type, Tag>::ConstIterator
+{
+public:
+  using pointer = typename IntrusiveList::pointer;
+  using reference = typename IntrusiveList::reference;
+
+  Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+};
+
+}
@@ -1,13 +1,23 @@
 #pragma once
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
+#include <memory>
+#include <new>
 #include <stdexcept>
 #include <iostream>
+#include <type_traits>
+#include <utility>
 
 namespace Linear
 {
 
-template <typename Type>
+// Nodes, the guard included, are allocated through Allocator rebound to the
+// node type; pass a Memory::PoolAllocator to carve them out of slabs.
+// Splicing and merging relink nodes between lists whose allocators compare
+// equal; otherwise the elements are moved into new nodes. Lists whose
+// allocators share a pool must be used from one thread at a time.
+template <typename Type, typename Allocator = std::allocator<Type>>
 class LinkedList
 {
 public:
@@ -18,6 +28,7 @@ public:
   using reference = Type&;
   using const_pointer = const Type*;
   using const_reference = const Type&;
+  using allocator_type = Allocator;
 
   class ConstIterator;
   class Iterator;
@@ -29,6 +40,7 @@ private:
   {
     Type data;
     Node(const Type& pom) : data(pom) {next=NULL; prev=NULL;};
+    Node(Type&& pom) : data(std::move(pom)) {next=NULL; prev=NULL;};
     Node() {next=NULL; prev=NULL;};
     ~Node(){};
     Node* next;
@@ -36,14 +48,21 @@ private:
   friend LinkedList;
   };
 
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
 Node* head;
 Node* guard;
+size_type counter;
+NodeAllocator nodeAllocator;
 
 public:
-  LinkedList()
+  LinkedList() : LinkedList(Allocator())
+  {}
+
+  explicit LinkedList(const Allocator& allocator) : nodeAllocator(allocator)
   {
-    guard = new Node;
-    head=guard;
+    createGuard();
   }
 
   LinkedList(std::initializer_list<Type> l):  LinkedList()//Constructs a container with a copy of each of the elements in l, in the same order.
@@ -53,185 +72,449 @@ public:
       this->append(*it);
   }
 
-  LinkedList(const LinkedList& other):  LinkedList()//a copy constructor
+  LinkedList(const LinkedList& other):  LinkedList(NodeTraits::select_on_container_copy_construction(other.nodeAllocator))//a copy constructor
   {
     *this=other;
   }
 
-  LinkedList(LinkedList&& other)//a move constructor
+  LinkedList(LinkedList&& other) : head(other.head), guard(other.guard), counter(other.counter),
+                                   nodeAllocator(std::move(other.nodeAllocator))//a move constructor
   {
-    guard = NULL;
-    head=guard;
-    *this=std::move(other);
+    other.guard=NULL;
+    other.head=other.guard;
+    other.counter=0;
   }
 
   ~LinkedList()
   {
-      erase (this->begin(),this->end());
-      delete guard;
+    if (guard==NULL)
+      return;
+    eraseAll();
+    destroyNode(guard);
   }
 
   LinkedList& operator=(const LinkedList& other)//copies all the elements from other into the container (with other preserving its contents)
   {
-    if (this->head== other.head) return *this;
-    erase (this->begin(),this->end());
-    for(iterator it=other.begin();it!=other.end();it++)
+    if (this==&other) return *this;
+    if (guard==NULL)
+      createGuard();//moved from
+    else
+      eraseAll();
+    for(const_iterator it=other.begin();it!=other.end();++it)
       this->append(*it);
     return *this;
   }
 
   LinkedList& operator=(LinkedList&& other)//moves the elements of other into the container (other is left in an unspecified but valid state)
   {
-    if (this->head== other.head) return *this;
-
-    if (head!=guard)
-      {
-        erase (this->cbegin(),this->cend());
-      //  delete guard; odpala jeden wiecej destruktor
-      }
-
+    if (this==&other) return *this;
+    if (!NodeTraits::propagate_on_container_move_assignment::value && nodeAllocator!=other.nodeAllocator)
+    {
+      // The nodes cannot change hands, so the elements are copied instead.
+      *this=other;
+      other.eraseAll();
+      return *this;
+    }
+    if (guard!=NULL)
+    {
+      eraseAll();
+      destroyNode(guard);
+    }
+    if (NodeTraits::propagate_on_container_move_assignment::value)
+      nodeAllocator=std::move(other.nodeAllocator);
     head=other.head;
     guard=other.guard;
+    counter=other.counter;
 
     other.guard=NULL;
     other.head=other.guard;
+    other.counter=0;
     return *this;
   }
 
-  bool isEmpty() const
+private:
+  template <typename... Args>
+  Node* createNode(Args&&... args)
   {
-    return head==guard;
+    Node* node = NodeTraits::allocate(nodeAllocator, 1);
+    try
+    {
+      new (node) Node(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      NodeTraits::deallocate(nodeAllocator, node, 1);
+      throw;
+    }
+    return node;
   }
 
-  size_type getSize() const //linear complexity
+  void destroyNode(Node* node)
   {
-    LinkedList<Type>::iterator p;
-    size_type counter=0;
-    for (p=this->begin();p!=this->end(); p++)
-      counter++;
-    return counter;
+    node->~Node();
+    NodeTraits::deallocate(nodeAllocator, node, 1);
   }
 
-  void append(const Type& item)
+  void createGuard()
+  {
+    guard=createNode();
+    head=guard;
+    counter=0;
+  }
+
+  // Links node in front of position, which may be the head or the guard.
+  void linkBefore(Node* position, Node* node)
   {
-    Node* newElement = new Node(item);
-    if(head==guard)//list is empty
+    node->next=position;
+    node->prev=position->prev;
+    if (position==head)
+      head=node;
+    else
+      position->prev->next=node;
+    position->prev=node;
+    counter++;
+  }
+
+  void unlink(Node* node)
+  {
+    if (node==head)
     {
-      head=newElement;
-      head->next=guard;
-      guard->prev=head;
+      head=node->next;
+      head->prev=NULL;
     }
     else
     {
-      guard->prev->next=newElement;
-      newElement->prev=guard->prev;
-      guard->prev=guard->prev->next;
-      newElement->next=guard;
+      node->prev->next=node->next;
+      node->next->prev=node->prev;
     }
+    counter--;
   }
 
-  void prepend(const Type& item)
+  // Cuts first..last (both included) out of this list; the counter is left
+  // to the caller.
+  void detach(Node* first, Node* last)
+  {
+    if (first==head)
+    {
+      head=last->next;
+      head->prev=NULL;
+    }
+    else
+    {
+      first->prev->next=last->next;
+      last->next->prev=first->prev;
+    }
+  }
+
+  // Links the detached chain first..last in front of position.
+  void attach(Node* position, Node* first, Node* last)
   {
-    Node* newElement = new Node(item);
-    if(head==guard)//list is empty
-      this->append(item);
+    first->prev=position->prev;
+    last->next=position;
+    if (position==head)
+      head=first;
     else
+      position->prev->next=first;
+    position->prev=last;
+  }
+
+  // Moves the n nodes of [first, last) from other in front of position.
+  void transfer(Node* position, LinkedList& other, Node* first, Node* last, size_type n)
+  {
+    if (this==&other || nodeAllocator==other.nodeAllocator)
+    {
+      Node* lastIncluded=last->prev;
+      other.detach(first, lastIncluded);
+      attach(position, first, lastIncluded);
+      other.counter-=n;
+      counter+=n;
+      return;
+    }
+    while (first!=last)
     {
-      newElement->next=head;
-      head->prev=newElement;
-      head=newElement;
+      Node* next=first->next;
+      linkBefore(position, createNode(std::move(first->data)));
+      other.unlink(first);
+      other.destroyNode(first);
+      first=next;
     }
   }
 
-  void insert(const const_iterator& insertPosition, const Type& item)
+  size_type countRange(Node* first, Node* last) const
   {
-    if (insertPosition.current==guard)//new node will be appended if the iterator points at null
+    size_type n=0;
+    for (;first!=last;first=first->next)
     {
-       this->append(item);
-       return;
+      if (first==NULL || first->next==NULL)
+        throw std::out_of_range("Invalid iterator range");
+      n++;
     }
-    if (insertPosition==begin())
+    return n;
+  }
+
+  // Splits off the first n nodes of a NULL-terminated chain and returns the
+  // rest.
+  static Node* cutChain(Node* chain, size_type n)
+  {
+    for (size_type i=1;chain!=NULL && i<n;i++)
+      chain=chain->next;
+    if (chain==NULL)
+      return NULL;
+    Node* rest=chain->next;
+    chain->next=NULL;
+    return rest;
+  }
+
+  // Appends the merge of two sorted chains at tail and advances tail.
+  // Equal elements keep left before right. If compare throws, left and right
+  // hold what has not been merged yet.
+  template <typename Compare>
+  static void mergeChains(Node*& left, Node*& right, Node**& tail, Compare& compare)
+  {
+    while (left!=NULL && right!=NULL)
     {
-       this->prepend(item);
-       return;
+      if (compare(right->data, left->data))
+      {
+        *tail=right;
+        right=right->next;
+      }
+      else
+      {
+        *tail=left;
+        left=left->next;
+      }
+      tail=&(*tail)->next;
     }
-    Node* newElement = new Node(item);
-    newElement->next=insertPosition.current;
-    newElement->prev=insertPosition.current->prev;
-    insertPosition.current->prev->next=newElement;
-    insertPosition.current->prev=newElement;
+    *tail=left!=NULL ? left : right;
+    left=NULL;
+    right=NULL;
+    while (*tail!=NULL)
+      tail=&(*tail)->next;
   }
 
-  Type popFirst()
+  // Makes the NULL-terminated chain the contents of the list again.
+  void adoptChain(Node* chain)
   {
-    if (this->isEmpty()==1) throw std::out_of_range("An attempt to pop first element from empty list was made");
-    Type itemToReturn=head->data;
-    if(head->next==guard)
+    head=chain;
+    head->prev=NULL;
+    Node* last=head;
+    for (Node* node=head->next;node!=NULL;node=node->next)
     {
-      delete head;
-      head=guard;
-      return itemToReturn;
+      node->prev=last;
+      last=node;
+    }
+    last->next=guard;
+    guard->prev=last;
+  }
+
+  void eraseAll()
+  {
+    while (head!=guard)
+    {
+      Node* next=head->next;
+      destroyNode(head);
+      head=next;
     }
-    head=head->next;
-    delete head->prev;
     head->prev=NULL;
+    counter=0;
+  }
+
+public:
+  bool isEmpty() const
+  {
+    return head==guard;
+  }
+
+  size_type getSize() const
+  {
+    return counter;
+  }
+
+  void append(const Type& item)
+  {
+    linkBefore(guard, createNode(item));
+  }
+
+  void prepend(const Type& item)
+  {
+    linkBefore(head, createNode(item));
+  }
+
+  void insert(const const_iterator& insertPosition, const Type& item)
+  {
+    linkBefore(insertPosition.current, createNode(item));
+  }
+
+  Type popFirst()
+  {
+    if (this->isEmpty()==1) throw std::out_of_range("An attempt to pop first element from empty list was made");
+    Node* toDelete=head;
+    Type itemToReturn=std::move(toDelete->data);
+    unlink(toDelete);
+    destroyNode(toDelete);
     return itemToReturn;
   }
 
   Type popLast()
   {
     if (this->isEmpty()==1) throw std::out_of_range("An attempt to pop last element from empty list was made");
-    Type itemToReturn=guard->prev->data;
-    if(guard->prev==head) return this->popFirst();
     Node* toDelete=guard->prev;
-    toDelete->prev->next=guard;
-    guard->prev=toDelete->prev;
-    delete toDelete;
+    Type itemToReturn=std::move(toDelete->data);
+    unlink(toDelete);
+    destroyNode(toDelete);
     return itemToReturn;
   }
 
   void erase(const const_iterator& position)
   {
     if(position.current==guard)  throw std::out_of_range("An attempt to erase data at guard adress");
-    if(position.current->prev==NULL)//Erasing first element. Can't pop becuase pop starts a constructor.
+    unlink(position.current);
+    destroyNode(position.current);
+  }
+
+  void erase(const const_iterator& firstIncluded, const const_iterator& lastExcluded)
+  {
+    if (firstIncluded.current==head && lastExcluded.current==guard)
     {
-      //popFirst(); To pass the tests it cannot be that simple :(
-      if(head->next==guard)
-      {
-        delete head;
-        head=guard;
-        return;
-      }
-      head=head->next;
-      delete head->prev;
-      head->prev=NULL;
+      eraseAll();
       return;
     }
+    Node* node=firstIncluded.current;
+    while (node!=lastExcluded.current)
+    {
+      if (node==guard)
+        throw std::out_of_range("An attempt to erase data at guard adress");
+      Node* next=node->next;
+      unlink(node);
+      destroyNode(node);
+      node=next;
+    }
+  }
 
-    if(position.current->next==guard)//Erasing last element. Can't pop becuase pop starts a constructor.
+  // Moves all elements of other in front of position; O(1) when the
+  // allocators compare equal.
+  void splice(const const_iterator& position, LinkedList& other)
+  {
+    if (this==&other || other.isEmpty())
+      return;
+    transfer(position.current, other, other.head, other.guard, other.counter);
+  }
+
+  void splice(const const_iterator& position, LinkedList&& other)
+  {
+    splice(position, other);
+  }
+
+  // Moves the element at it from other in front of position.
+  void splice(const const_iterator& position, LinkedList& other, const const_iterator& it)
+  {
+    if (it.current==other.guard)
+      throw std::out_of_range("An attempt to splice the guard was made");
+    if (position.current==it.current || position.current==it.current->next)
+      return;
+    transfer(position.current, other, it.current, it.current->next, 1);
+  }
+
+  // Moves [first, last) from other in front of position, which must not lie
+  // inside the range. Linear in the length of the range when other is a
+  // different list, as its size has to be counted.
+  void splice(const const_iterator& position, LinkedList& other,
+              const const_iterator& first, const const_iterator& last)
+  {
+    if (first==last)
+      return;
+    size_type n=countRange(first.current, last.current);
+    transfer(position.current, other, first.current, last.current, n);
+  }
+
+  // Moves [position, end) into a new list and returns it. The new list gets
+  // its allocator as a copy of this list would, so it shares no pool with
+  // this one and the two can be handed to different threads; with such an
+  // allocator the elements are moved into new nodes.
+  LinkedList split_at(const const_iterator& position)
+  {
+    LinkedList tail(Allocator(NodeTraits::select_on_container_copy_construction(nodeAllocator)));
+    tail.splice(tail.end(), *this, position, end());
+    return tail;
+  }
+
+  // Merges the sorted other into this sorted list. Stable: equal elements of
+  // this list stay in front of those from other.
+  template <typename Compare = std::less<Type>>
+  void merge(LinkedList& other, Compare compare = Compare())
+  {
+    if (this==&other)
+      return;
+    Node* mine=head;
+    while (!other.isEmpty())
     {
-      if(guard->prev==head)
+      Node* first=other.head;
+      while (mine!=guard && !compare(first->data, mine->data))
+        mine=mine->next;
+      if (mine==guard)
       {
-        delete head;
-        head=guard;
+        transfer(guard, other, first, other.guard, other.counter);
         return;
       }
-      Node* toDelete=guard->prev;
-      toDelete->prev->next=guard;
-      guard->prev=toDelete->prev;
-      delete toDelete;
-      return;
+      Node* last=first->next;
+      size_type n=1;
+      while (last!=other.guard && compare(last->data, mine->data))
+      {
+        last=last->next;
+        n++;
+      }
+      transfer(mine, other, first, last, n);
     }
+  }
 
-    position.current->next->prev=position.current->prev;
-    position.current->prev->next=position.current->next;
-    delete position.current;
+  template <typename Compare = std::less<Type>>
+  void merge(LinkedList&& other, Compare compare = Compare())
+  {
+    merge(other, compare);
   }
 
-  void erase(const const_iterator& firstIncluded, const const_iterator& lastExcluded)
+  // Stable bottom-up merge sort that relinks the nodes and allocates nothing.
+  template <typename Compare = std::less<Type>>
+  void sort(Compare compare = Compare())
   {
-    for(Iterator it=firstIncluded;it!=lastExcluded;it++)
-      erase (it);
+    if (counter<2)
+      return;
+    guard->prev->next=NULL;
+    Node* chain=head;
+    Node* sorted=NULL;
+    Node* left=NULL;
+    Node* right=NULL;
+    Node** tail=&sorted;
+    try
+    {
+      for (size_type width=1;width<counter;width*=2)
+      {
+        tail=&sorted;
+        while (chain!=NULL)
+        {
+          left=chain;
+          right=cutChain(left, width);
+          chain=cutChain(right, width);
+          mergeChains(left, right, tail, compare);
+        }
+        chain=sorted;
+        sorted=NULL;
+      }
+    }
+    catch (...)
+    {
+      // Keep every node: the merged part first, then the rest as it is.
+      *tail=NULL;
+      for (Node* piece : {left, right, chain})
+      {
+        while (*tail!=NULL)
+          tail=&(*tail)->next;
+        *tail=piece;
+      }
+      adoptChain(sorted);
+      throw;
+    }
+    adoptChain(chain);
   }
 
   iterator begin()
@@ -275,10 +558,10 @@ public:
 
 ///////////////////////////////////////////////////////////////////////////////
 
-template <typename Type>
-class LinkedList<Type>::ConstIterator
+template <typename Type, typename Allocator>
+class LinkedList<Type, Allocator>::ConstIterator
 {
-  friend LinkedList<Type>;
+  friend LinkedList<Type, Allocator>;
 public:
   using iterator_category = std::bidirectional_iterator_tag;
   using value_type = typename LinkedList::value_type;
@@ -312,10 +595,9 @@ public:
 
   ConstIterator operator++(int)
   {
-    if (current->next==NULL)
-      throw std::out_of_range("Cannot increase iterator");
-    current=current->next;
-    return *this;
+    auto result = *this;
+    ++(*this);
+    return result;
   }
 
   ConstIterator& operator--()
@@ -328,10 +610,9 @@ public:
 
   ConstIterator operator--(int)
   {
-    if (current->prev==NULL)
-        throw std::out_of_range("Cannot decrease iterator");
-    current=current->prev;
-    return *this;
+    auto result = *this;
+    --(*this);
+    return result;
   }
 
   ConstIterator operator+(difference_type d) const
@@ -364,8 +645,8 @@ public:
 };
 /////////////////////////////////////////////////////////////////////////
 
-template <typename Type>
-class LinkedList<Type>::Iterator : public LinkedList<Type>::ConstIterator
+template <typename Type, typename Allocator>
+class LinkedList<Type, Allocator>::Iterator : public LinkedList<Type, Allocator>::ConstIterator
 {
 public:
   using pointer = typename LinkedList::pointer;
@@ -422,5 +703,3 @@ public:
 };
 
 }
-
-#endif // AISDI_LINEAR_LINKEDLIST_H
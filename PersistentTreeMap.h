@@ -0,0 +1,624 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "HazardPointers.h"
+
+namespace Maps {
+
+// Ordered map whose versions share structure. An update copies the path
+// from the root to the changed node and keeps every other subtree, so it
+// costs O(log n) new nodes and leaves older versions intact. Nodes are
+// reference counted and freed by whoever drops the last reference.
+//
+// One writer at a time updates the map (writers are serialized); any number
+// of readers take snapshot() in O(1) without locking and iterate it without
+// blocking the writer. The current root and size are published together as
+// one version, which readers pin with a Memory::HazardPointers guard while
+// they retain its root. The tree is an AVL tree, whose rebalancing needs
+// no parent pointers and so fits path copying.
+template <typename KeyType, typename ValueType>
+class PersistentTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair< key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class Snapshot;
+  class ConstIterator;
+  using const_iterator = ConstIterator;
+
+private:
+  // Immutable once reachable from a published root.
+  struct Node
+  {
+    value_type data;
+    Node* left;
+    Node* right;
+    int height;
+    mutable std::atomic<size_type> references;
+
+    Node(const value_type& data, Node* left, Node* right)
+      :data(data), left(left), right(right), height(1), references(1)
+    {
+      updateHeight(this);
+    }
+  };
+
+  // Replaced as a whole by every update and retired, not deleted, so that
+  // readers still holding it can retain its root.
+  struct Version
+  {
+    Node* root;//owned reference
+    size_type counter;
+
+    Version(Node* root, size_type counter):root(root), counter(counter)
+    {}
+
+    ~Version()
+    {
+      release(root);
+    }
+  };
+
+  std::atomic<Version*> current;
+  std::mutex writeLock;//serializes writers
+
+  static Node* retain(Node* node)
+  {
+    if (node!=NULL)
+      node->references.fetch_add(1, std::memory_order_relaxed);
+    return node;
+  }
+
+  static void release(Node* node)
+  {
+    while (node!=NULL && node->references.fetch_sub(1, std::memory_order_acq_rel)==1)
+    {
+      release(node->left);
+      Node* right=node->right;
+      delete node;
+      node=right;
+    }
+  }
+
+  static int heightOf(const Node* node)
+  {
+    return node==NULL ? 0 : node->height;
+  }
+
+  static void updateHeight(Node* node)
+  {
+    int left=heightOf(node->left);
+    int right=heightOf(node->right);
+    node->height=(left>right ? left : right)+1;
+  }
+
+  // The functions below take and return owned references. A node they have
+  // just created is not shared yet and may be changed in place.
+  static Node* rotateRight(Node* node)
+  {
+    Node* left=node->left;
+    Node* pivot=new Node(left->data, retain(left->left), node);
+    node->left=retain(left->right);
+    release(left);
+    updateHeight(node);
+    updateHeight(pivot);
+    return pivot;
+  }
+
+  static Node* rotateLeft(Node* node)
+  {
+    Node* right=node->right;
+    Node* pivot=new Node(right->data, node, retain(right->right));
+    node->right=retain(right->left);
+    release(right);
+    updateHeight(node);
+    updateHeight(pivot);
+    return pivot;
+  }
+
+  // Replaces a possibly shared child by a private copy that can be rotated.
+  static Node* unshare(Node* node)
+  {
+    Node* copy=new Node(node->data, retain(node->left), retain(node->right));
+    release(node);
+    return copy;
+  }
+
+  static Node* balance(Node* node)
+  {
+    int difference=heightOf(node->left)-heightOf(node->right);
+    if (difference>1)
+    {
+      if (heightOf(node->left->left)<heightOf(node->left->right))
+        node->left=rotateLeft(unshare(node->left));
+      return rotateRight(node);
+    }
+    if (difference<-1)
+    {
+      if (heightOf(node->right->right)<heightOf(node->right->left))
+        node->right=rotateRight(unshare(node->right));
+      return rotateLeft(node);
+    }
+    return node;
+  }
+
+  // New tree with key mapped to value. With overwrite false an existing
+  // key keeps its value and the old tree is returned.
+  static Node* insert(Node* node, const key_type& key, const mapped_type& value, bool overwrite, bool& inserted)
+  {
+    if (node==NULL)
+    {
+      inserted=true;
+      return new Node(value_type(key, value), NULL, NULL);
+    }
+    if (key<node->data.first)
+    {
+      Node* left=insert(node->left, key, value, overwrite, inserted);
+      if (left==node->left)
+      {
+        release(left);
+        return retain(node);
+      }
+      return balance(new Node(node->data, left, retain(node->right)));
+    }
+    if (node->data.first<key)
+    {
+      Node* right=insert(node->right, key, value, overwrite, inserted);
+      if (right==node->right)
+      {
+        release(right);
+        return retain(node);
+      }
+      return balance(new Node(node->data, retain(node->left), right));
+    }
+    inserted=false;
+    if (!overwrite)
+      return retain(node);
+    return new Node(value_type(key, value), retain(node->left), retain(node->right));
+  }
+
+  static Node* removeMinimum(Node* node)
+  {
+    if (node->left==NULL)
+      return retain(node->right);
+    return balance(new Node(node->data, removeMinimum(node->left), retain(node->right)));
+  }
+
+  // New tree without key, or the old tree if key is absent.
+  static Node* remove(Node* node, const key_type& key)
+  {
+    if (node==NULL)
+      return NULL;
+    if (key<node->data.first)
+    {
+      Node* left=remove(node->left, key);
+      if (left==node->left)
+      {
+        release(left);
+        return retain(node);
+      }
+      return balance(new Node(node->data, left, retain(node->right)));
+    }
+    if (node->data.first<key)
+    {
+      Node* right=remove(node->right, key);
+      if (right==node->right)
+      {
+        release(right);
+        return retain(node);
+      }
+      return balance(new Node(node->data, retain(node->left), right));
+    }
+    if (node->left==NULL)
+      return retain(node->right);
+    if (node->right==NULL)
+      return retain(node->left);
+    const Node* minimum=node->right;
+    while (minimum->left!=NULL)
+      minimum=minimum->left;
+    return balance(new Node(minimum->data, retain(node->left), removeMinimum(node->right)));
+  }
+
+  static const Node* findNode(const Node* node, const key_type& key)
+  {
+    while (node!=NULL)
+    {
+      if (key<node->data.first)
+        node=node->left;
+      else if (node->data.first<key)
+        node=node->right;
+      else
+        return node;
+    }
+    return NULL;
+  }
+
+  // Only writers replace versions, so the writer holding writeLock can use
+  // the current one without a guard.
+  Version* latest() const
+  {
+    return current.load(std::memory_order_acquire);
+  }
+
+  // Replaces the current version by newRoot, an owned reference.
+  void publish(Node* newRoot, size_type newCounter)
+  {
+    Version* version;
+    try
+    {
+      version=new Version(newRoot, newCounter);
+    }
+    catch (...)
+    {
+      release(newRoot);
+      throw;
+    }
+    Memory::HazardPointers::retire(current.exchange(version, std::memory_order_acq_rel));
+  }
+
+public:
+  PersistentTreeMap():current(new Version(NULL, 0))
+  {}
+
+  PersistentTreeMap(std::initializer_list<value_type> list) : PersistentTreeMap()
+  {
+    for (auto it = list.begin(); it != list.end(); ++it)
+      insert_or_assign((*it).first, (*it).second);
+  }
+
+  // Copies share every node with other and cost O(1).
+  PersistentTreeMap(const PersistentTreeMap& other) : PersistentTreeMap()
+  {
+    Snapshot version=other.snapshot();
+    publish(retain(version.root), version.counter);
+  }
+
+  PersistentTreeMap& operator=(const PersistentTreeMap& other)
+  {
+    if (this == &other)
+      return *this;
+    Snapshot version=other.snapshot();
+    std::lock_guard<std::mutex> guard(writeLock);
+    publish(retain(version.root), version.counter);
+    return *this;
+  }
+
+  ~PersistentTreeMap()
+  {
+    delete current.load(std::memory_order_relaxed);
+  }
+
+  // Frozen view of the current version. It stays valid and unchanged
+  // while the map is updated, and keeps its nodes alive until destroyed.
+  Snapshot snapshot() const
+  {
+    Memory::HazardPointers::Guard guard;
+    Version* version=guard.protect(current);
+    return Snapshot(retain(version->root), version->counter);
+  }
+
+  // Returns true if key was not present.
+  bool insert_or_assign(const key_type& key, const mapped_type& value)
+  {
+    std::lock_guard<std::mutex> guard(writeLock);
+    bool inserted=false;
+    Version* version=latest();
+    Node* newRoot=insert(version->root, key, value, true, inserted);
+    publish(newRoot, inserted ? version->counter+1 : version->counter);
+    return inserted;
+  }
+
+  // Inserts only if key is not present; returns true if it inserted.
+  bool try_emplace(const key_type& key, const mapped_type& value)
+  {
+    std::lock_guard<std::mutex> guard(writeLock);
+    bool inserted=false;
+    Version* version=latest();
+    Node* newRoot=insert(version->root, key, value, false, inserted);
+    if (!inserted)
+    {
+      release(newRoot);
+      return false;
+    }
+    publish(newRoot, version->counter+1);
+    return true;
+  }
+
+  void remove(const key_type& key)
+  {
+    std::lock_guard<std::mutex> guard(writeLock);
+    Version* version=latest();
+    if (findNode(version->root, key)==NULL)
+      throw std::out_of_range ("Removal of nonexisting node");
+    publish(remove(version->root, key), version->counter-1);
+  }
+
+  void erase()
+  {
+    std::lock_guard<std::mutex> guard(writeLock);
+    publish(NULL, 0);
+  }
+
+  // Reads go through a snapshot, so they are safe next to a writer.
+  mapped_type valueOf(const key_type& key) const
+  {
+    return snapshot().valueOf(key);
+  }
+
+  bool contains(const key_type& key) const
+  {
+    return snapshot().contains(key);
+  }
+
+  size_type getSize() const
+  {
+    Memory::HazardPointers::Guard guard;
+    return guard.protect(current)->counter;
+  }
+
+  bool isEmpty() const
+  {
+    return getSize()==0;
+  }
+
+  bool operator==(const PersistentTreeMap& other) const
+  {
+    return snapshot()==other.snapshot();
+  }
+
+  bool operator!=(const PersistentTreeMap& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+
+template <typename KeyType, typename ValueType>
+class PersistentTreeMap<KeyType, ValueType>::Snapshot
+{
+  friend PersistentTreeMap;
+
+  Node* root;
+  size_type counter;
+
+  Snapshot(Node* root, size_type counter):root(root), counter(counter)
+  {}
+
+public:
+  Snapshot(const Snapshot& other):root(retain(other.root)), counter(other.counter)
+  {}
+
+  Snapshot(Snapshot&& other):root(other.root), counter(other.counter)
+  {
+    other.root=NULL;
+    other.counter=0;
+  }
+
+  Snapshot& operator=(Snapshot other)
+  {
+    std::swap(root, other.root);
+    std::swap(counter, other.counter);
+    return *this;
+  }
+
+  ~Snapshot()
+  {
+    release(root);
+  }
+
+  size_type getSize() const
+  {
+    return counter;
+  }
+
+  bool isEmpty() const
+  {
+    return counter==0;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const
+  {
+    if (root==NULL)
+      throw std::out_of_range ("Calling valueOf() when the map is empty");
+    const Node* node=findNode(root, key);
+    if (node==NULL)
+      throw std::out_of_range ("Calling valueOf() with nonexisting key");
+    return node->data.second;
+  }
+
+  bool contains(const key_type& key) const
+  {
+    return findNode(root, key)!=NULL;
+  }
+
+  const_iterator find(const key_type& key) const
+  {
+    ConstIterator it(root);
+    const Node* node=root;
+    while (node!=NULL)
+    {
+      it.path.push_back(node);
+      if (key<node->data.first)
+        node=node->left;
+      else if (node->data.first<key)
+        node=node->right;
+      else
+        return it;
+    }
+    return end();
+  }
+
+  const_iterator begin() const
+  {
+    ConstIterator it(root);
+    for (const Node* node=root;node!=NULL;node=node->left)
+      it.path.push_back(node);
+    return it;
+  }
+
+  const_iterator end() const
+  {
+    return ConstIterator(root);
+  }
+
+  const_iterator cbegin() const
+  {
+    return begin();
+  }
+
+  const_iterator cend() const
+  {
+    return end();
+  }
+
+  bool operator==(const Snapshot& other) const
+  {
+    if (counter!=other.counter)
+      return 0;
+    if (root==other.root)
+      return 1;
+    auto itThis=begin();
+    for (auto it=other.begin(); it!=other.end();it++)
+      {
+        if (*it != *itThis)
+          return 0;
+        itThis++;
+      }
+      return 1;
+  }
+
+  bool operator!=(const Snapshot& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+
+// Walks a snapshot through the path from the root to the current node, as
+// nodes shared between versions have no parent pointers. Valid while the
+// snapshot it came from is alive.
+template <typename KeyType, typename ValueType>
+class PersistentTreeMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename PersistentTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename PersistentTreeMap::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const typename PersistentTreeMap::value_type*;
+  friend Snapshot;
+
+private:
+  const Node* root;
+  std::vector<const Node*> path;//empty at end()
+
+  explicit ConstIterator(const Node* root):root(root)
+  {}
+
+public:
+  ConstIterator():root(NULL)
+  {}
+
+  ConstIterator& operator++()
+  {
+    if (path.empty())
+      throw std::out_of_range("Wrong pointer at operator++");
+    const Node* node=path.back();
+    if (node->right!=NULL)
+    {
+      for (node=node->right;node!=NULL;node=node->left)
+        path.push_back(node);
+      return *this;
+    }
+    path.pop_back();
+    while (!path.empty() && path.back()->right==node)
+    {
+      node=path.back();
+      path.pop_back();
+    }
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto result = *this;
+    ++(*this);
+    return result;
+  }
+
+  ConstIterator& operator--()
+  {
+    if (path.empty())
+    {
+      if (root==NULL)
+        throw std::out_of_range("Wrong pointer at operator--");
+      for (const Node* node=root;node!=NULL;node=node->right)
+        path.push_back(node);
+      return *this;
+    }
+    const Node* node=path.back();
+    if (node->left!=NULL)
+    {
+      for (node=node->left;node!=NULL;node=node->right)
+        path.push_back(node);
+      return *this;
+    }
+    // The predecessor is the nearest ancestor reached from its right child;
+    // the path is left as it is if there is none.
+    size_type i=path.size()-1;
+    while (i>0 && path[i-1]->left==path[i])
+      i--;
+    if (i==0)
+      throw std::out_of_range("Wrong pointer at operator--");
+    path.resize(i);
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto result = *this;
+    --(*this);
+    return result;
+  }
+
+  reference operator*() const
+  {
+    if (path.empty())
+      throw std::out_of_range("Wrong pointer at operator*");
+    return path.back()->data;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    if (path.empty() || other.path.empty())
+      return path.empty() && other.path.empty();
+    return path.back() == other.path.back();
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace Memory {
+
+// Slabs shared by the copies of a PoolAllocator. Chunks of one size come
+// from one pool, whatever type they are handed out as; slab memory is
+// aligned for any fundamental type and a pool's chunks sit at multiples of
+// its chunk size, so a type may use any pool whose size is a multiple of
+// its alignment. Not synchronized.
+class PoolArena
+{
+public:
+  using size_type = std::size_t;
+
+  static constexpr size_type GRAIN = alignof(void*);
+
+private:
+  static constexpr size_type MAX_ALIGN = alignof(std::max_align_t);
+  static constexpr size_type SLAB_HEADER = (sizeof(void*)+MAX_ALIGN-1)/MAX_ALIGN*MAX_ALIGN;
+
+  struct Chunk
+  {
+    Chunk* next;
+  };
+
+  struct Pool
+  {
+    void* slabs;//every slab starts with a pointer to the previous one
+    Chunk* freeList;
+    size_type untouched;//chunks at the end of the newest slab never handed out
+
+    Pool() : slabs(NULL), freeList(NULL), untouched(0)
+    {}
+  };
+
+  std::vector<Pool> pools;//indexed by chunk size / GRAIN
+
+public:
+  PoolArena() = default;
+  PoolArena(const PoolArena&) = delete;
+  PoolArena& operator=(const PoolArena&) = delete;
+
+  ~PoolArena()
+  {
+    release();
+  }
+
+  // chunkSize must be a multiple of GRAIN.
+  void* allocate(size_type chunkSize, size_type slabSize)
+  {
+    size_type index=chunkSize/GRAIN;
+    if (pools.size()<=index)
+      pools.resize(index+1);
+    Pool& pool=pools[index];
+    Chunk* chunk;
+    if (pool.freeList!=NULL)
+    {
+      chunk=pool.freeList;
+      pool.freeList=chunk->next;
+    }
+    else
+    {
+      if (pool.untouched==0)
+      {
+        void* slab=::operator new(SLAB_HEADER+slabSize*chunkSize);
+        *static_cast<void**>(slab)=pool.slabs;
+        pool.slabs=slab;
+        pool.untouched=slabSize;
+      }
+      unsigned char* first=static_cast<unsigned char*>(pool.slabs)+SLAB_HEADER;
+      chunk=reinterpret_cast<Chunk*>(first+(slabSize-pool.untouched)*chunkSize);
+      pool.untouched--;
+    }
+    return chunk;
+  }
+
+  void deallocate(void* pointer, size_type chunkSize) noexcept
+  {
+    Pool& pool=pools[chunkSize/GRAIN];
+    Chunk* chunk=static_cast<Chunk*>(pointer);
+    chunk->next=pool.freeList;
+    pool.freeList=chunk;
+  }
+
+  void release() noexcept
+  {
+    for (Pool& pool : pools)
+    {
+      while (pool.slabs!=NULL)
+      {
+        void* previous=*static_cast<void**>(pool.slabs);
+        ::operator delete(pool.slabs);
+        pool.slabs=previous;
+      }
+      pool.freeList=NULL;
+      pool.untouched=0;
+    }
+  }
+
+  static constexpr bool canHold(size_type alignment)
+  {
+    return alignment<=MAX_ALIGN;
+  }
+};
+
+// Allocator for node-based containers. Single objects are carved out of
+// slabs of SlabSize objects and recycled through intrusive free lists;
+// requests for more than one object go to std::allocator.
+//
+// The slabs belong to a PoolArena shared by all copies and rebound copies
+// of an allocator, so they compare equal and can free each other's memory,
+// as the Allocator requirements demand. The arena is freed with the last
+// allocator referring to it. It is not synchronized: containers that
+// share an arena must be used from one thread at a time. Copying a
+// container gives the copy a new arena.
+template <typename Type, std::size_t SlabSize = 256>
+class PoolAllocator
+{
+public:
+  using value_type = Type;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
+
+  template <typename Other>
+  struct rebind
+  {
+    using other = PoolAllocator<Other, SlabSize>;
+  };
+
+  static_assert(SlabSize!=0, "SlabSize must be positive");
+
+  template <typename Other, std::size_t OtherSlabSize>
+  friend class PoolAllocator;
+
+private:
+  static constexpr size_type ALIGN = alignof(Type)>PoolArena::GRAIN ? alignof(Type) : PoolArena::GRAIN;
+  static constexpr size_type CHUNK_SIZE = ((sizeof(Type)>sizeof(void*) ? sizeof(Type) : sizeof(void*))+ALIGN-1)/ALIGN*ALIGN;
+  static constexpr bool POOLED = PoolArena::canHold(alignof(Type));
+
+  std::shared_ptr<PoolArena> arena;
+
+public:
+  PoolAllocator() : arena(std::make_shared<PoolArena>())
+  {}
+
+  PoolAllocator(const PoolAllocator&) noexcept = default;
+
+  template <typename Other>
+  PoolAllocator(const PoolAllocator<Other, SlabSize>& other) noexcept : arena(other.arena)
+  {}
+
+  // A moved-from allocator must still be able to free what it handed out,
+  // so moving shares the arena like copying does.
+  PoolAllocator(PoolAllocator&& other) noexcept : arena(other.arena)
+  {}
+
+  PoolAllocator& operator=(const PoolAllocator&) noexcept = default;
+
+  PoolAllocator& operator=(PoolAllocator&& other) noexcept
+  {
+    arena=other.arena;
+    return *this;
+  }
+
+  PoolAllocator select_on_container_copy_construction() const
+  {
+    return PoolAllocator();
+  }
+
+  Type* allocate(size_type n)
+  {
+    if (n!=1 || !POOLED)
+      return std::allocator<Type>().allocate(n);
+    return static_cast<Type*>(arena->allocate(CHUNK_SIZE, SlabSize));
+  }
+
+  void deallocate(Type* pointer, size_type n) noexcept
+  {
+    if (n!=1 || !POOLED)
+    {
+      std::allocator<Type>().deallocate(pointer, n);
+      return;
+    }
+    arena->deallocate(pointer, CHUNK_SIZE);
+  }
+
+  // Frees every slab of the arena, for all copies of this allocator.
+  // Objects still living in them are not destroyed, and every pointer
+  // handed out by allocate(1) becomes invalid.
+  void release() noexcept
+  {
+    arena->release();
+  }
+
+  template <typename Other>
+  bool operator==(const PoolAllocator<Other, SlabSize>& other) const noexcept
+  {
+    return arena==other.arena;
+  }
+
+  template <typename Other>
+  bool operator!=(const PoolAllocator<Other, SlabSize>& other) const noexcept
+  {
+    return !(*this == other);
+  }
+};
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+#include "VectorBase.h"
+
+namespace Linear
+{
+
+// Vector with room for N elements inside the object itself. Until it holds
+// more than N elements it never touches the heap; past that it moves to
+// heap storage and grows like Vector. Built from, and convertible to, any
+// iterator range, so elements pass between SmallVector and Vector through
+// begin()/end().
+template <typename Type, std::size_t N = 8>
+class SmallVector : public VectorBase<Type, SmallVector<Type, N>>
+{
+  using Base = VectorBase<Type, SmallVector<Type, N>>;
+  friend Base;
+
+public:
+  static_assert(N!=0, "SmallVector needs inline capacity; use Vector instead");
+
+private:
+  static constexpr std::size_t INLINE_CAPACITY = N;
+
+  alignas(Type) unsigned char inlineStorage[N*sizeof(Type)];
+
+  Type* inlineArray()
+  {
+    return reinterpret_cast<Type*>(inlineStorage);
+  }
+
+  const Type* inlineArray() const
+  {
+    return reinterpret_cast<const Type*>(inlineStorage);
+  }
+
+public:
+
+  SmallVector()
+  {
+    this->useInlineStorage();
+  }
+
+  SmallVector(std::initializer_list<Type> l): SmallVector()
+  {
+    this->assign(l.begin(), l.end());
+  }
+
+  template <typename InputIterator,
+            typename = typename std::iterator_traits<InputIterator>::iterator_category>
+  SmallVector(InputIterator first, InputIterator last): SmallVector()
+  {
+    this->assign(first, last);
+  }
+
+  SmallVector(const SmallVector& other): SmallVector()
+  {
+    this->copyFrom(other);
+  }
+
+  SmallVector(SmallVector&& other): SmallVector()
+  {
+    this->moveFrom(other);
+  }
+
+  ~SmallVector()
+  {
+    this->releaseStorage();
+  }
+
+  SmallVector& operator=(const SmallVector& other)
+  {
+    this->copyFrom(other);
+    return *this;
+  }
+
+  SmallVector& operator=(SmallVector&& other)
+  {
+    this->moveFrom(other);
+    return *this;
+  }
+
+  // True while the elements live in the inline buffer.
+  bool isSmall() const
+  {
+    return this->isInline();
+  }
+};
+
+}
@@ -1,13 +1,40 @@
 #pragma once
 
 #include <cstddef>
+#include <future>
 #include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
 namespace Maps {
 
-template <typename KeyType, typename ValueType>
+// Policies for TreeMap's Policy parameter. With OrderStatistics every node
+// also stores the size of its subtree, which enables rank(), select(),
+// advance() and distance() in O(log n).
+struct PlainTree
+{
+  using countsSubtrees = std::false_type;
+  struct NodeBase {};
+};
+
+struct OrderStatistics
+{
+  using countsSubtrees = std::true_type;
+  struct NodeBase
+  {
+    std::size_t subtreeSize=0;
+  };
+};
+
+// Nodes are allocated through Allocator rebound to the node type.
+template <typename KeyType, typename ValueType, typename Allocator = std::allocator<std::pair<KeyType, ValueType>>,
+          typename Policy = PlainTree>
 class TreeMap
 {
 public:
@@ -15,8 +42,10 @@ public:
   using mapped_type = ValueType;
   using value_type = std::pair< key_type, mapped_type>;
   using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
   using reference = value_type&;
   using const_reference = const value_type&;
+  using allocator_type = Allocator;
 
   class ConstIterator;
   class Iterator;
@@ -25,7 +54,7 @@ public:
   enum Color {RED, BLACK};
 private:
 
-  class Node
+  class Node : public Policy::NodeBase
   {
     value_type data;
     Color color;
@@ -33,61 +62,93 @@ private:
     Node* right;
     Node* parent;
     Node() {right=NULL; left=NULL; parent=NULL;};
+    template <typename... Args>
+    explicit Node(std::piecewise_construct_t, Args&&... args)
+      :data(std::piecewise_construct, std::forward<Args>(args)...) {right=NULL; left=NULL; parent=NULL;}
     ~Node(){};
     friend TreeMap;
   };
 
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
+
   Node* root;
   Node* guard;
+  Node* leftmost;//the minimum; the maximum is guard->parent
   size_type counter;
+  NodeAllocator nodeAllocator;
 public:
 
-  TreeMap()
+  TreeMap() : TreeMap(Allocator())
+  {}
+
+  explicit TreeMap(const Allocator& allocator) : nodeAllocator(allocator)
   {
-    guard= new Node;
-    guard->color=BLACK;
-    root=guard;
-    guard->parent=guard;
-    counter=0;
+    createGuard();
   }
 
   TreeMap(std::initializer_list<value_type> list) : TreeMap()
   {
-    for (auto it = list.begin(); it != list.end(); ++it)
-      (*this)[(*it).first]=(*it).second;
+    assign(list.begin(), list.end());
   }
 
-  TreeMap(const TreeMap& other): TreeMap()
+  template <typename InputIt>
+  TreeMap(InputIt first, InputIt last) : TreeMap()
+  {
+    assign(first, last);
+  }
+
+  TreeMap(const TreeMap& other): TreeMap(NodeTraits::select_on_container_copy_construction(other.nodeAllocator))
   {
     *this = other;
   }
 
-  TreeMap(TreeMap&& other)
+  TreeMap(TreeMap&& other) : root(other.root), guard(other.guard), leftmost(other.leftmost),
+                             counter(other.counter), nodeAllocator(std::move(other.nodeAllocator))
   {
-    root=NULL;
-    guard=root;
-    *this = std::move(other);
+    other.root=NULL;
+    other.guard=NULL;
+    other.leftmost=NULL;
+    other.counter=0;
   }
 
   TreeMap& operator=(const TreeMap& other)
   {
-    if (root != other.root)
-      erase();
-    for (auto it=other.begin(); it!=other.end();it++)
-      (*this)[(*it).first]=(*it).second;
+    if (this != &other)
+      assign(other.begin(), other.end());
     return *this;
   }
 
   TreeMap& operator=(TreeMap&& other)
   {
-    if (root != other.root)
+    if (this == &other)
+      return *this;
+    if (!NodeTraits::propagate_on_container_move_assignment::value && nodeAllocator!=other.nodeAllocator)
+    {
+      // The nodes cannot change hands, so the values are moved instead.
+      if (guard==NULL)
+        createGuard();
+      erase();
+      for (auto it=other.begin(); it!=other.end();it++)
+        (*this)[std::move((*it).first)]=std::move((*it).second);
+      other.erase();
+      return *this;
+    }
+    if (guard!=NULL)
+    {
       erase();
+      destroyNode(guard);
+    }
+    if (NodeTraits::propagate_on_container_move_assignment::value)
+      nodeAllocator=std::move(other.nodeAllocator);
     root=other.root;
     guard=other.guard;
+    leftmost=other.leftmost;
     counter=other.counter;
 
     other.root=NULL;
     other.guard=NULL;
+    other.leftmost=NULL;
     other.counter=0;
     return *this;
   }
@@ -95,10 +156,624 @@ public:
   ~TreeMap()
   {
     erase();
+    if (guard!=NULL)
+      destroyNode(guard);
   }
 
 ////////////////////////////////////////////////////////////////////////////////
 private:
+  template <typename... Args>
+  Node* createNode(Args&&... args)
+  {
+    Node* z = NodeTraits::allocate(nodeAllocator, 1);
+    try
+    {
+      new (z) Node(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      NodeTraits::deallocate(nodeAllocator, z, 1);
+      throw;
+    }
+    return z;
+  }
+
+  void destroyNode(Node* z)
+  {
+    z->~Node();
+    NodeTraits::deallocate(nodeAllocator, z, 1);
+  }
+
+  void createGuard()
+  {
+    guard=createNode();
+    guard->color=BLACK;
+    root=guard;
+    leftmost=guard;
+    guard->parent=guard;
+    counter=0;
+  }
+
+  // Post-order teardown: every node is visited once and nothing is rebalanced.
+  void destroySubtree(Node* x)
+  {
+    while (x!=guard)
+    {
+      destroySubtree(x->right);
+      Node* left=x->left;
+      destroyNode(x);
+      x=left;
+    }
+  }
+
+  void destroyAll()
+  {
+    destroySubtree(root);
+    root=guard;
+    leftmost=guard;
+    guard->parent=guard;
+    counter=0;
+  }
+
+  using Counted = typename Policy::countsSubtrees;
+
+  void updateSize(Node* x)
+  {
+    updateSize(x, Counted());
+  }
+
+  void updateSize(Node* x, std::true_type)
+  {
+    x->subtreeSize=x->left->subtreeSize+x->right->subtreeSize+1;
+  }
+
+  void updateSize(Node*, std::false_type)
+  {}
+
+  // Recounts x and its ancestors after a node was added or unlinked below x.
+  void updatePath(Node* x)
+  {
+    if (Counted::value)
+      for (;x!=guard;x=x->parent)
+        updateSize(x);
+  }
+
+  // Prepends the subtree's nodes, in order, to list, which is linked
+  // through the right pointers and ends with NULL.
+  void flatten(Node* x, Node*& list)
+  {
+    while (x!=guard)
+    {
+      flatten(x->right, list);
+      Node* left=x->left;
+      x->right=list;
+      list=x;
+      x=left;
+    }
+  }
+
+  void destroyChain(Node* list)
+  {
+    while (list!=NULL)
+    {
+      Node* next=list->right;
+      destroyNode(list);
+      list=next;
+    }
+  }
+
+  // Turns the first n nodes of list into a subtree of minimal height and
+  // advances list past them. Every null link ends up on one of two adjacent
+  // levels, so colouring the deeper level red keeps all black heights equal.
+  Node* buildSubtree(Node*& list, size_type n, size_type depth, size_type redDepth)
+  {
+    if (n==0)
+      return guard;
+    Node* left=buildSubtree(list, (n-1)/2, depth+1, redDepth);
+    Node* x=list;
+    list=list->right;
+    x->left=left;
+    if (left!=guard)
+      left->parent=x;
+    x->right=buildSubtree(list, n-1-(n-1)/2, depth+1, redDepth);
+    if (x->right!=guard)
+      x->right->parent=x;
+    x->color= depth==redDepth ? RED : BLACK;
+    updateSize(x);
+    return x;
+  }
+
+  // Replaces the (empty) tree with the n sorted, distinct nodes of list.
+  void buildFromChain(Node* list, size_type n)
+  {
+    size_type height=0;
+    while (height<sizeof(size_type)*8 && (size_type(1)<<height)<=n)
+      height++;
+    // A perfect tree needs no red level.
+    size_type redDepth= (n&(n+1))==0 ? height : height-1;
+    leftmost= list==NULL ? guard : list;
+    root=buildSubtree(list, n, 0, redDepth);
+    root->parent=guard;
+    counter=n;
+    guard->parent= root==guard ? guard : treeMaximum(root);
+  }
+
+  // Merges the sorted chain theirs into the tree in one pass over both. For
+  // keys present on both sides the tree's node stays and theirs is freed.
+  void mergeChain(Node* theirs)
+  {
+    Node* mine=NULL;
+    flatten(root, mine);
+    root=guard;
+    Node* head=NULL;
+    Node* tail=NULL;
+    size_type n=0;
+    while (mine!=NULL || theirs!=NULL)
+    {
+      Node* z;
+      if (theirs==NULL || (mine!=NULL && !(theirs->data.first<mine->data.first)))
+      {
+        if (theirs!=NULL && !(mine->data.first<theirs->data.first))
+        {
+          Node* duplicate=theirs;
+          theirs=theirs->right;
+          destroyNode(duplicate);
+        }
+        z=mine;
+        mine=mine->right;
+      }
+      else
+      {
+        z=theirs;
+        theirs=theirs->right;
+      }
+      if (tail==NULL)
+        head=z;
+      else
+        tail->right=z;
+      tail=z;
+      n++;
+    }
+    if (tail!=NULL)
+      tail->right=NULL;
+    buildFromChain(head, n);
+  }
+
+  // Copies (or moves, through move iterators) the range into a chain of new
+  // nodes. The chain stops at the first key that is not above its
+  // predecessor; that position is returned with the chain.
+  template <typename InputIt>
+  std::pair<Node*, size_type> chainOf(InputIt& first, InputIt last)
+  {
+    Node* head=NULL;
+    Node* tail=NULL;
+    size_type n=0;
+    try
+    {
+      for (;first!=last;++first)
+      {
+        if (tail!=NULL && !(tail->data.first<(*first).first))
+          break;
+        Node* z=createNode(std::piecewise_construct,
+                           std::forward_as_tuple((*first).first),
+                           std::forward_as_tuple((*first).second));
+        if (tail==NULL)
+          head=z;
+        else
+          tail->right=z;
+        tail=z;
+        n++;
+      }
+    }
+    catch (...)
+    {
+      if (tail!=NULL)
+        tail->right=NULL;
+      destroyChain(head);
+      throw;
+    }
+    if (tail!=NULL)
+      tail->right=NULL;
+    return std::make_pair(head, n);
+  }
+
+  // Split and join work on detached subtrees: the guard stands for an empty
+  // tree, a subtree root's parent pointer is left stale and the root may be
+  // red. They only relink existing nodes and never write to the guard, so
+  // disjoint subtrees can be processed by different threads.
+  enum SetOperation {UNION, INTERSECTION, DIFFERENCE};
+
+  // Nodes dropped by a set operation, freed once all threads are done, and
+  // the number of keys found in both trees.
+  struct Leftovers
+  {
+    Node* head;
+    Node* tail;
+    size_type found;
+
+    Leftovers():head(NULL), tail(NULL), found(0) {}
+
+    void push(Node* x)
+    {
+      x->right=NULL;
+      if (tail==NULL)
+        head=x;
+      else
+        tail->right=x;
+      tail=x;
+    }
+
+    void append(Leftovers& other)
+    {
+      if (other.head!=NULL)
+      {
+        if (tail==NULL)
+          head=other.head;
+        else
+          tail->right=other.head;
+        tail=other.tail;
+      }
+      found+=other.found;
+    }
+  };
+
+  // Trees whose root has at least this black height, and so at least
+  // 2^FORK_HEIGHT-1 nodes, are split between two threads while more than
+  // one thread is left for them; smaller ones are not worth a thread.
+  static constexpr size_type FORK_HEIGHT = 10;
+
+  static unsigned threadCount(unsigned threads)
+  {
+    if (threads==0)
+      threads=std::thread::hardware_concurrency();
+    return threads!=0 ? threads : 1;
+  }
+
+  // A subtree with its black height: the number of black nodes on every
+  // path from its root down to the guard. join, split and the set
+  // operations pass heights along, so none of them has to walk a spine.
+  struct Subtree
+  {
+    Node* root;
+    size_type height;
+  };
+
+  // Walks the left spine; only used once per set operation.
+  size_type blackHeight(Node* t) const
+  {
+    size_type height=0;
+    for (;t!=guard;t=t->left)
+      if (t->color==BLACK)
+        height++;
+    return height;
+  }
+
+  Subtree subtree(Node* t, size_type height) const
+  {
+    Subtree result={t, height};
+    return result;
+  }
+
+  Subtree leftOf(const Subtree& t) const
+  {
+    return subtree(t.root->left, t.root->color==BLACK ? t.height-1 : t.height);
+  }
+
+  Subtree rightOf(const Subtree& t) const
+  {
+    return subtree(t.root->right, t.root->color==BLACK ? t.height-1 : t.height);
+  }
+
+  Node* link(Node* left, Node* x, Node* right, Color color)
+  {
+    x->left=left;
+    x->right=right;
+    if (left!=guard)
+      left->parent=x;
+    if (right!=guard)
+      right->parent=x;
+    x->color=color;
+    updateSize(x);
+    return x;
+  }
+
+  Node* rotateSubtreeLeft(Node* x)
+  {
+    Node* y=x->right;
+    link(x->left, x, y->left, x->color);
+    return link(x, y, y->right, y->color);
+  }
+
+  Node* rotateSubtreeRight(Node* y)
+  {
+    Node* x=y->left;
+    link(x->right, y, y->right, y->color);
+    return link(x->left, x, y, x->color);
+  }
+
+  // Hangs tr with x on the right spine of the taller or equally tall tl,
+  // at the first black node of tr's black height.
+  Node* joinRight(Node* tl, size_type heightL, Node* x, Node* tr, size_type heightR)
+  {
+    if (tl->color==BLACK && heightL==heightR)
+      return link(tl, x, tr, RED);
+    size_type childHeight= tl->color==BLACK ? heightL-1 : heightL;
+    Node* right=joinRight(tl->right, childHeight, x, tr, heightR);
+    link(tl->left, tl, right, tl->color);
+    if (tl->color==BLACK && right->color==RED && right->right->color==RED)
+    {
+      right->right->color=BLACK;
+      return rotateSubtreeLeft(tl);
+    }
+    return tl;
+  }
+
+  Node* joinLeft(Node* tl, size_type heightL, Node* x, Node* tr, size_type heightR)
+  {
+    if (tr->color==BLACK && heightL==heightR)
+      return link(tl, x, tr, RED);
+    size_type childHeight= tr->color==BLACK ? heightR-1 : heightR;
+    Node* left=joinLeft(tl, heightL, x, tr->left, childHeight);
+    link(left, tr, tr->right, tr->color);
+    if (tr->color==BLACK && left->color==RED && left->left->color==RED)
+    {
+      left->left->color=BLACK;
+      return rotateSubtreeRight(tr);
+    }
+    return tr;
+  }
+
+  // Tree with the keys of tl, then x, then the keys of tr.
+  Subtree join(Subtree tl, Node* x, Subtree tr)
+  {
+    if (tl.root->color==RED)
+    {
+      tl.root->color=BLACK;
+      tl.height++;
+    }
+    if (tr.root->color==RED)
+    {
+      tr.root->color=BLACK;
+      tr.height++;
+    }
+    if (tl.height>tr.height)
+    {
+      Node* t=joinRight(tl.root, tl.height, x, tr.root, tr.height);
+      if (t->color==RED && t->right->color==RED)
+      {
+        t->color=BLACK;
+        return subtree(t, tl.height+1);
+      }
+      return subtree(t, tl.height);
+    }
+    if (tr.height>tl.height)
+    {
+      Node* t=joinLeft(tl.root, tl.height, x, tr.root, tr.height);
+      if (t->color==RED && t->left->color==RED)
+      {
+        t->color=BLACK;
+        return subtree(t, tr.height+1);
+      }
+      return subtree(t, tr.height);
+    }
+    return subtree(link(tl.root, x, tr.root, RED), tl.height);
+  }
+
+  Subtree join(Subtree tl, Subtree tr)
+  {
+    if (tl.root==guard)
+      return tr;
+    Node* last;
+    Subtree rest=splitLast(tl, last);
+    return join(rest, last, tr);
+  }
+
+  Subtree splitLast(Subtree t, Node*& last)
+  {
+    Subtree left=leftOf(t);
+    Subtree right=rightOf(t);
+    if (right.root==guard)
+    {
+      last=t.root;
+      return left;
+    }
+    Subtree rest=splitLast(right, last);
+    return join(left, t.root, rest);
+  }
+
+  // Splits t into the keys below key and the keys above it; the node
+  // holding key, if any, is stored in found.
+  std::pair<Subtree, Subtree> split(Subtree t, const key_type& key, Node*& found)
+  {
+    if (t.root==guard)
+      return std::make_pair(t, t);
+    Subtree left=leftOf(t);
+    Subtree right=rightOf(t);
+    if (key<t.root->data.first)
+    {
+      auto parts=split(left, key, found);
+      return std::make_pair(parts.first, join(parts.second, t.root, right));
+    }
+    if (t.root->data.first<key)
+    {
+      auto parts=split(right, key, found);
+      return std::make_pair(join(left, t.root, parts.first), parts.second);
+    }
+    found=t.root;
+    return std::make_pair(left, right);
+  }
+
+  void discard(Node* x, Leftovers& leftovers)
+  {
+    while (x!=guard)
+    {
+      discard(x->right, leftovers);
+      Node* left=x->left;
+      leftovers.push(x);
+      x=left;
+    }
+  }
+
+  // t1's root splits t2, the halves are combined recursively and joined
+  // back around the root if it stays. For equal keys t1's node is kept.
+  // The halves share threads, the number of threads that may work on this
+  // call at once.
+  Subtree setOperation(SetOperation operation, Subtree t1, Subtree t2, Leftovers& leftovers, unsigned threads)
+  {
+    if (t1.root==guard || t2.root==guard)
+    {
+      if (operation==UNION)
+        return t1.root==guard ? t2 : t1;
+      discard(t2.root, leftovers);
+      if (operation==DIFFERENCE)
+        return t1;
+      discard(t1.root, leftovers);
+      return subtree(guard, 0);
+    }
+    Subtree left=leftOf(t1);
+    Subtree right=rightOf(t1);
+    Node* found=NULL;
+    auto parts=split(t2, t1.root->data.first, found);
+
+    Subtree l;
+    Subtree r;
+    Leftovers rightLeftovers;
+    if (threads>1 && t1.height>=FORK_HEIGHT)
+    {
+      unsigned rightThreads=threads/2;
+      auto task=std::async(std::launch::async, [&]() {
+        return setOperation(operation, right, parts.second, rightLeftovers, rightThreads);
+      });
+      l=setOperation(operation, left, parts.first, leftovers, threads-rightThreads);
+      r=task.get();
+    }
+    else
+    {
+      l=setOperation(operation, left, parts.first, leftovers, 1);
+      r=setOperation(operation, right, parts.second, rightLeftovers, 1);
+    }
+    leftovers.append(rightLeftovers);
+
+    bool keep;
+    if (found!=NULL)
+    {
+      leftovers.found++;
+      leftovers.push(found);
+      keep= operation!=DIFFERENCE;
+    }
+    else
+      keep= operation!=INTERSECTION;
+    if (keep)
+      return join(l, t1.root, r);
+    leftovers.push(t1.root);
+    return join(l, r);
+  }
+
+  // Replaces the tree with its combination with theirs, a tree of
+  // theirCount nodes that already uses this map's guard.
+  void combine(SetOperation operation, Node* theirs, size_type theirCount, unsigned threads)
+  {
+    Leftovers leftovers;
+    Subtree mine=subtree(root, blackHeight(root));
+    root=setOperation(operation, mine, subtree(theirs, blackHeight(theirs)), leftovers, threadCount(threads)).root;
+    if (operation==UNION)
+      counter+=theirCount-leftovers.found;
+    else if (operation==INTERSECTION)
+      counter=leftovers.found;
+    else
+      counter-=leftovers.found;
+    if (root!=guard)
+    {
+      root->parent=guard;
+      root->color=BLACK;
+    }
+    leftmost= root==guard ? guard : treeMinimum(root);
+    guard->parent= root==guard ? guard : treeMaximum(root);
+    destroyChain(leftovers.head);
+  }
+
+  Node* createCopy(Node* x, std::false_type)
+  {
+    return createNode(std::piecewise_construct,
+                      std::forward_as_tuple(x->data.first),
+                      std::forward_as_tuple(x->data.second));
+  }
+
+  Node* createCopy(Node* x, std::true_type)
+  {
+    return createNode(std::piecewise_construct,
+                      std::forward_as_tuple(std::move(x->data.first)),
+                      std::forward_as_tuple(std::move(x->data.second)));
+  }
+
+  // Copy of the other map's tree, shape and colours included, built with
+  // this map's allocator and guard. With Move the values are moved out.
+  template <typename Move>
+  Node* cloneTree(const TreeMap& other, Node* x, Move move)
+  {
+    if (x==other.guard)
+      return guard;
+    Node* left=cloneTree(other, x->left, move);
+    Node* right;
+    Node* z;
+    try
+    {
+      right=cloneTree(other, x->right, move);
+    }
+    catch (...)
+    {
+      destroySubtree(left);
+      throw;
+    }
+    try
+    {
+      z=createCopy(x, move);
+    }
+    catch (...)
+    {
+      destroySubtree(left);
+      destroySubtree(right);
+      throw;
+    }
+    return link(left, z, right, x->color);
+  }
+
+  // Points the leaves of a subtree of another map at this map's guard.
+  void adoptSubtree(Node* x, Node* otherGuard)
+  {
+    while (x!=guard)
+    {
+      if (x->left==otherGuard)
+        x->left=guard;
+      if (x->right==otherGuard)
+        x->right=guard;
+      adoptSubtree(x->right, otherGuard);
+      x=x->left;
+    }
+  }
+
+  // Takes the other map's tree: the nodes themselves if the allocators
+  // are equal, moved values in new nodes otherwise. other ends up empty.
+  Node* takeTree(TreeMap& other)
+  {
+    if (nodeAllocator!=other.nodeAllocator)
+    {
+      Node* theirs=cloneTree(other, other.root, std::true_type());
+      other.erase();
+      return theirs;
+    }
+    Node* theirs=other.root;
+    if (theirs==other.guard)
+      theirs=guard;
+    else
+      adoptSubtree(theirs, other.guard);
+    other.root=other.guard;
+    other.leftmost=other.guard;
+    other.guard->parent=other.guard;
+    other.counter=0;
+    return theirs;
+  }
+
   void leftRotate (Node* x)
   {
     if (x->right==guard)
@@ -119,6 +794,8 @@ private:
     }
     y->left=x;
     x->parent=y;
+    updateSize(x);
+    updateSize(y);
   }
 
   void rightRotate (Node* y)
@@ -141,6 +818,8 @@ private:
     }
     x->right=y;
     y->parent=x;
+    updateSize(y);
+    updateSize(x);
   }
 
   void insertFixUp(Node* z)
@@ -210,13 +889,20 @@ void transplant (Node* u, Node* v)
   v->parent=u->parent;
 }
 
-Node* treeMinimum(Node* x)
+Node* treeMinimum(Node* x) const
 {
   while (x->left!=guard)
     x=x->left;
   return x;
 }
 
+Node* treeMaximum(Node* x) const
+{
+  while (x->right!=guard)
+    x=x->right;
+  return x;
+}
+
 void deleteFixUp(Node* x)
 {
   Node* w;
@@ -288,54 +974,207 @@ void deleteFixUp(Node* x)
   x->color=BLACK;
 }
 
-////////////////////////////////////////////////////////////////////////////////
-public:
-  bool isEmpty() const
+// Returns the node holding key, or the node a new key would be attached to
+// (the guard for an empty tree), so an insert needs only one descent.
+std::pair<Node*, bool> findPosition(const key_type& key) const
+{
+  Node* y = guard;
+  Node* x = root;
+  while(x!=guard)
   {
-    return root==guard;
+    y=x;
+    if (key<x->data.first)
+      x=x->left;
+    else if (x->data.first<key)
+      x=x->right;
+    else
+      return std::make_pair(x, true);
   }
+  return std::make_pair(y, false);
+}
 
-  mapped_type& operator[](const key_type& key)
+void attach(Node* y, Node* z)
+{
+  z->parent=y;
+  if (y==guard)
+    root=z;
+  else
   {
-    auto it = find (key);
-    if (it.current!=guard)
-      return (it.current->data).second;
+    if (z->data.first<y->data.first)
+      y->left=z;
+    else
+      y->right=z;
+  }
+  z->left=guard;
+  z->right=guard;
+  z->color=RED;
+  // Rotations never change which node is the minimum or the maximum.
+  if (y==guard || (y==leftmost && y->left==z))
+    leftmost=z;
+  if (y==guard || (y==guard->parent && y->right==z))
+    guard->parent=z;
+  updatePath(z);
+  insertFixUp(z);
+  counter++;
+}
+
+template <typename KArg, typename... Args>
+std::pair<Node*, bool> emplaceKey(KArg&& key, Args&&... args)
+{
+  auto position=findPosition(key);
+  if (position.second)
+    return std::make_pair(position.first, false);
+  Node* z = createNode(std::piecewise_construct,
+                       std::forward_as_tuple(std::forward<KArg>(key)),
+                       std::forward_as_tuple(std::forward<Args>(args)...));
+  attach(position.first, z);
+  return std::make_pair(z, true);
+}
 
-    Node* z = new Node;
-    z->data.first=key;
+template <typename KArg, typename M>
+std::pair<Node*, bool> assignKey(KArg&& key, M&& value)
+{
+  auto position=findPosition(key);
+  if (position.second)
+  {
+    position.first->data.second=std::forward<M>(value);
+    return std::make_pair(position.first, false);
+  }
+  Node* z = createNode(std::piecewise_construct,
+                       std::forward_as_tuple(std::forward<KArg>(key)),
+                       std::forward_as_tuple(std::forward<M>(value)));
+  attach(position.first, z);
+  return std::make_pair(z, true);
+}
 
-    Node* y = guard;
-    Node* x = root;
-    while(x!=guard)
+// First node whose key is not below key (lower) or above key (upper).
+Node* boundNode(const key_type& key, bool upper) const
+{
+  Node* result=guard;
+  Node* x=root;
+  while (x!=guard)
+  {
+    if (upper ? key<x->data.first : !(x->data.first<key))
     {
-      y=x;
-      if (z->data.first<x->data.first)
-        x=x->left;
-      else
-        x=x->right;
-      }
-    z->parent=y;
-    if (y==guard)
-      root=z;
+      result=x;
+      x=x->left;
+    }
+    else
+      x=x->right;
+  }
+  return result;
+}
+
+// Last node whose key is not above key.
+Node* floorNode(const key_type& key) const
+{
+  Node* result=guard;
+  Node* x=root;
+  while (x!=guard)
+  {
+    if (key<x->data.first)
+      x=x->left;
     else
     {
-      if (z->data.first<y->data.first)
-        y->left=z;
-      else
-        y->right=z;
+      result=x;
+      x=x->right;
     }
-    z->left=guard;
-    z->right=guard;
-    z->color=RED;
-    insertFixUp(z);
+  }
+  return result;
+}
 
-    x=root;
-    while (x->right!=guard)
+// Node with k smaller keys, or the guard if k is not below the size.
+Node* selectNode(size_type k) const
+{
+  Node* x=root;
+  while (x!=guard)
+  {
+    size_type leftSize=x->left->subtreeSize;
+    if (k<leftSize)
+      x=x->left;
+    else if (k==leftSize)
+      return x;
+    else
+    {
+      k-=leftSize+1;
       x=x->right;
-    guard->parent=x;
+    }
+  }
+  return guard;
+}
+
+// Number of keys below the node; the guard's position is the size.
+size_type positionOf(const Node* x) const
+{
+  if (x==guard)
+    return counter;
+  size_type position=x->left->subtreeSize;
+  for (;x->parent!=guard;x=x->parent)
+    if (x==x->parent->right)
+      position+=x->parent->left->subtreeSize+1;
+  return position;
+}
+
+iterator iteratorAt(Node* node) const
+{
+  Iterator it;
+  it.current=node;
+  return it;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+public:
+  bool isEmpty() const
+  {
+    return root==guard;
+  }
+
+  mapped_type& operator[](const key_type& key)
+  {
+    return emplaceKey(key).first->data.second;
+  }
+
+  mapped_type& operator[](key_type&& key)
+  {
+    return emplaceKey(std::move(key)).first->data.second;
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+  {
+    auto result=emplaceKey(key, std::forward<Args>(args)...);
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+  {
+    auto result=emplaceKey(std::move(key), std::forward<Args>(args)...);
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  // The key is needed before the descent, so the pair is built first and
+  // moved into a new node only if its key is not present yet.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args)
+  {
+    value_type element(std::forward<Args>(args)...);
+    auto result=emplaceKey(std::move(element.first), std::move(element.second));
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& value)
+  {
+    auto result=assignKey(key, std::forward<M>(value));
+    return std::make_pair(iteratorAt(result.first), result.second);
+  }
 
-    counter++;
-    return z->data.second;
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& value)
+  {
+    auto result=assignKey(std::move(key), std::forward<M>(value));
+    return std::make_pair(iteratorAt(result.first), result.second);
   }
 
   const mapped_type& valueOf(const key_type& key) const
@@ -388,6 +1227,243 @@ public:
     return toReturn;
   }
 
+  iterator lower_bound(const key_type& key)
+  {
+    return iteratorAt(boundNode(key, false));
+  }
+
+  const_iterator lower_bound(const key_type& key) const
+  {
+    return iteratorAt(boundNode(key, false));
+  }
+
+  iterator upper_bound(const key_type& key)
+  {
+    return iteratorAt(boundNode(key, true));
+  }
+
+  const_iterator upper_bound(const key_type& key) const
+  {
+    return iteratorAt(boundNode(key, true));
+  }
+
+  std::pair<iterator, iterator> equal_range(const key_type& key)
+  {
+    return std::make_pair(lower_bound(key), upper_bound(key));
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const
+  {
+    return std::make_pair(lower_bound(key), upper_bound(key));
+  }
+
+  // Greatest key not above key, or end() if there is none.
+  iterator floor(const key_type& key)
+  {
+    return iteratorAt(floorNode(key));
+  }
+
+  const_iterator floor(const key_type& key) const
+  {
+    return iteratorAt(floorNode(key));
+  }
+
+  // Smallest key not below key, or end() if there is none.
+  iterator ceiling(const key_type& key)
+  {
+    return lower_bound(key);
+  }
+
+  const_iterator ceiling(const key_type& key) const
+  {
+    return lower_bound(key);
+  }
+
+  const_reference first() const
+  {
+    if (root==guard)
+      throw std::out_of_range ("Calling first() when the map is empty");
+    return leftmost->data;
+  }
+
+  const_reference last() const
+  {
+    if (root==guard)
+      throw std::out_of_range ("Calling last() when the map is empty");
+    return guard->parent->data;
+  }
+
+  // Calls visitor(value_type&) for every entry with a key in [low, high), in
+  // order. Only the path to low and the visited nodes are touched.
+  template <typename Visitor>
+  void forEachInRange(const key_type& low, const key_type& high, Visitor visitor)
+  {
+    for (auto it=lower_bound(low); it!=end() && (*it).first<high; ++it)
+      visitor(*it);
+  }
+
+  template <typename Visitor>
+  void forEachInRange(const key_type& low, const key_type& high, Visitor visitor) const
+  {
+    for (auto it=lower_bound(low); it!=end() && (*it).first<high; ++it)
+      visitor(*it);
+  }
+
+  // Replaces the contents with the range. A range sorted by strictly
+  // increasing key is built in O(n); the part after the first key out of
+  // order is inserted one by one, later values overwriting earlier ones.
+  template <typename InputIt>
+  void assign(InputIt first, InputIt last)
+  {
+    if (guard==NULL)
+      createGuard();//moved from
+    erase();
+    auto chain=chainOf(first, last);
+    buildFromChain(chain.first, chain.second);
+    for (;first!=last;++first)
+      (*this)[(*first).first]=(*first).second;
+  }
+
+  // Adds the entries of other whose keys are not present yet, in
+  // O(getSize() + other.getSize()).
+  void merge(const TreeMap& other)
+  {
+    if (this == &other)
+      return;
+    auto first=other.begin();
+    mergeChain(chainOf(first, other.end()).first);
+  }
+
+  // Same as above, but the entries are taken out of other, which ends up
+  // empty. With equal allocators the nodes themselves change hands.
+  void merge(TreeMap&& other)
+  {
+    if (this == &other)
+      return;
+    if (nodeAllocator==other.nodeAllocator)
+    {
+      Node* theirs=NULL;
+      other.flatten(other.root, theirs);
+      other.root=other.guard;
+      other.leftmost=other.guard;
+      other.guard->parent=other.guard;
+      other.counter=0;
+      mergeChain(theirs);
+      return;
+    }
+    auto first=std::make_move_iterator(other.begin());
+    mergeChain(chainOf(first, std::make_move_iterator(other.end())).first);
+    other.erase();
+  }
+
+  // Set operations in place, in O(m log(n/m + 1)) for sizes m <= n. The
+  // root of this tree splits the other one and both halves recurse, on up
+  // to threads threads near the top; 0 uses
+  // std::thread::hardware_concurrency(). Entries of other are copied first,
+  // or taken over from an rvalue other, which ends up empty.
+  void uniteWith(const TreeMap& other, unsigned threads=0)
+  {
+    if (this != &other)
+      combine(UNION, cloneTree(other, other.root, std::false_type()), other.counter, threads);
+  }
+
+  void uniteWith(TreeMap&& other, unsigned threads=0)
+  {
+    if (this == &other)
+      return;
+    size_type theirCount=other.counter;
+    combine(UNION, takeTree(other), theirCount, threads);
+  }
+
+  void intersectWith(const TreeMap& other, unsigned threads=0)
+  {
+    if (this != &other)
+      combine(INTERSECTION, cloneTree(other, other.root, std::false_type()), other.counter, threads);
+  }
+
+  void intersectWith(TreeMap&& other, unsigned threads=0)
+  {
+    if (this == &other)
+      return;
+    size_type theirCount=other.counter;
+    combine(INTERSECTION, takeTree(other), theirCount, threads);
+  }
+
+  void subtract(const TreeMap& other, unsigned threads=0)
+  {
+    if (this == &other)
+      erase();
+    else
+      combine(DIFFERENCE, cloneTree(other, other.root, std::false_type()), other.counter, threads);
+  }
+
+  void subtract(TreeMap&& other, unsigned threads=0)
+  {
+    if (this == &other)
+    {
+      erase();
+      return;
+    }
+    size_type theirCount=other.counter;
+    combine(DIFFERENCE, takeTree(other), theirCount, threads);
+  }
+
+  // Number of keys below key.
+  size_type rank(const key_type& key) const
+  {
+    static_assert(Counted::value, "rank() needs the OrderStatistics policy");
+    size_type result=0;
+    Node* x=root;
+    while (x!=guard)
+    {
+      if (x->data.first<key)
+      {
+        result+=x->left->subtreeSize+1;
+        x=x->right;
+      }
+      else
+        x=x->left;
+    }
+    return result;
+  }
+
+  // Iterator to the k-th smallest key, counting from 0; select(getSize())
+  // is end().
+  iterator select(size_type k)
+  {
+    static_assert(Counted::value, "select() needs the OrderStatistics policy");
+    if (k>counter)
+      throw std::out_of_range ("Calling select() with index out of range");
+    return iteratorAt(selectNode(k));
+  }
+
+  const_iterator select(size_type k) const
+  {
+    static_assert(Counted::value, "select() needs the OrderStatistics policy");
+    if (k>counter)
+      throw std::out_of_range ("Calling select() with index out of range");
+    return iteratorAt(selectNode(k));
+  }
+
+  iterator advance(const const_iterator& it, difference_type k)
+  {
+    static_assert(Counted::value, "advance() needs the OrderStatistics policy");
+    return select(positionOf(it.current)+k);
+  }
+
+  const_iterator advance(const const_iterator& it, difference_type k) const
+  {
+    static_assert(Counted::value, "advance() needs the OrderStatistics policy");
+    return select(positionOf(it.current)+k);
+  }
+
+  // Number of increments that take first to last.
+  difference_type distance(const const_iterator& first, const const_iterator& last) const
+  {
+    static_assert(Counted::value, "distance() needs the OrderStatistics policy");
+    return static_cast<difference_type>(positionOf(last.current))-static_cast<difference_type>(positionOf(first.current));
+  }
+
   void remove(const key_type& key)
   {
     auto it = find (key);
@@ -401,6 +1477,14 @@ public:
     Node* y =z;
     Color yOriginalColor = y->color;
 
+    // The minimum has no left child and the maximum no right child, so
+    // their neighbours are a child's extreme or the parent.
+    Node* maximum=guard->parent;
+    if (z==leftmost)
+      leftmost= z->right!=guard ? treeMinimum(z->right) : z->parent;
+    if (z==maximum)
+      maximum= z->left!=guard ? treeMaximum(z->left) : z->parent;
+
     if (z->left==guard)
     {
       x=z->right;
@@ -434,15 +1518,14 @@ public:
           y->color=z->color;
         }
       }
+    updatePath(x->parent);
     if (yOriginalColor==BLACK)
       deleteFixUp(x);
 
-    delete z;
+    destroyNode(z);
     counter--;
-    x=root;
-    while (x->right!=guard && root != guard)
-      x=x->right;
-    guard->parent=x;
+    // transplant() and deleteFixUp() may have written guard->parent.
+    guard->parent=maximum;
   }
 
   void remove(const const_iterator& it)
@@ -454,9 +1537,7 @@ public:
   {
     if(getSize()==0)
       return;
-    while (root!=guard)
-      remove ((root->data).first);
-
+    destroyAll();
   }
 
   size_type getSize() const
@@ -486,11 +1567,8 @@ public:
 
   iterator begin()
   {
-    Node* current=root;
-    while (current->left!=guard  && root != guard)
-      current=current->left;
     Iterator it;
-    it.current=current;
+    it.current=leftmost;
     return it;
   }
 
@@ -503,11 +1581,8 @@ public:
 
   const_iterator cbegin() const
   {
-    Node* current=root;
-    while (current->left!=guard  && root != guard)
-      current=current->left;
     ConstIterator it;
-    it.current=current;
+    it.current=leftmost;
     return it;
   }
 
@@ -531,13 +1606,14 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////////////
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Allocator, typename Policy>
+class TreeMap<KeyType, ValueType, Allocator, Policy>::ConstIterator
 {
 public:
   using reference = typename TreeMap::const_reference;
   using iterator_category = std::bidirectional_iterator_tag;
   using value_type = typename TreeMap::value_type;
+  using difference_type = typename TreeMap::difference_type;
   using pointer = const typename TreeMap::value_type*;
   friend TreeMap;
 
@@ -555,6 +1631,12 @@ public:
         current=other.current;
   }
 
+  ConstIterator& operator=(const ConstIterator& other)
+  {
+    current=other.current;
+    return *this;
+  }
+
   ConstIterator& operator++()
   {
     if( current->right == NULL)
@@ -648,8 +1730,8 @@ public:
 
 ///////////////////////////////////////////////////////////////////////////////////
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::Iterator : public TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Allocator, typename Policy>
+class TreeMap<KeyType, ValueType, Allocator, Policy>::Iterator : public TreeMap<KeyType, ValueType, Allocator, Policy>::ConstIterator
 {
 public:
   using reference = typename TreeMap::reference;
@@ -0,0 +1,668 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace Linear
+{
+
+// Doubly linked list of chunks, each holding up to CAPACITY elements in a
+// contiguous array of about ChunkBytes, so a scan takes one cache miss per
+// chunk rather than per element. A full chunk is split in half on insert,
+// and a chunk that drops below half full after an erase takes elements from
+// or merges with a neighbour. Inserting or erasing invalidates iterators.
+template <typename Type, std::size_t ChunkBytes = 512>
+class UnrolledList
+{
+public:
+  using difference_type = std::ptrdiff_t;
+  using size_type = std::size_t;
+  using value_type = Type;
+  using pointer = Type*;
+  using reference = Type&;
+  using const_pointer = const Type*;
+  using const_reference = const Type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+private:
+  static constexpr size_type CAPACITY = ChunkBytes/sizeof(Type) < 4 ? 4 : ChunkBytes/sizeof(Type);
+  static constexpr size_type MIN_FILL = CAPACITY/2;
+
+  struct Chunk
+  {
+    Chunk* next;
+    Chunk* prev;
+    size_type count;
+    alignas(Type) unsigned char storage[CAPACITY*sizeof(Type)];//only the first count slots hold objects
+
+    Chunk() : next(NULL), prev(NULL), count(0)
+    {}
+
+    Type* slots()
+    {
+      return reinterpret_cast<Type*>(storage);
+    }
+  };
+
+  struct Position
+  {
+    Chunk* chunk;//NULL past the last element
+    size_type index;
+  };
+
+  Chunk* head;
+  Chunk* tail;
+  size_type counter;
+
+public:
+  UnrolledList() : head(NULL), tail(NULL), counter(0)
+  {}
+
+  UnrolledList(std::initializer_list<Type> l) : UnrolledList()
+  {
+    typename std::initializer_list<Type>::iterator it;
+    for(it=l.begin();it!=l.end();it++)
+      this->append(*it);
+  }
+
+  UnrolledList(const UnrolledList& other) : UnrolledList()
+  {
+    *this=other;
+  }
+
+  UnrolledList(UnrolledList&& other) : UnrolledList()
+  {
+    *this=std::move(other);
+  }
+
+  ~UnrolledList()
+  {
+    clear();
+  }
+
+  UnrolledList& operator=(const UnrolledList& other)
+  {
+    if (this==&other)
+      return *this;
+    clear();
+    for (const_iterator it=other.begin();it!=other.end();++it)
+      append(*it);
+    return *this;
+  }
+
+  UnrolledList& operator=(UnrolledList&& other)
+  {
+    if (this==&other)
+      return *this;
+    clear();
+    head=other.head;
+    tail=other.tail;
+    counter=other.counter;
+
+    other.head=NULL;
+    other.tail=NULL;
+    other.counter=0;
+    return *this;
+  }
+
+private:
+  // Moves n elements to to, leaving the source slots raw. The ranges may
+  // overlap.
+  static void relocate(Type* from, size_type n, Type* to)
+  {
+    if (n==0 || from==to)
+      return;
+    if (std::is_trivially_copyable<Type>::value)
+    {
+      std::memmove(static_cast<void*>(to), static_cast<const void*>(from), n*sizeof(Type));
+      return;
+    }
+    if (to<from)
+      for (size_type i=0;i<n;i++)
+      {
+        new (to+i) Type(std::move(from[i]));
+        from[i].~Type();
+      }
+    else
+      for (size_type i=n;i-->0;)
+      {
+        new (to+i) Type(std::move(from[i]));
+        from[i].~Type();
+      }
+  }
+
+  static void destroyRange(Type* first, size_type n)
+  {
+    if (!std::is_trivially_destructible<Type>::value)
+      for (size_type i=0;i<n;i++)
+        first[i].~Type();
+  }
+
+  // Creates an empty chunk after position, or in front of the head when
+  // position is NULL.
+  Chunk* createChunkAfter(Chunk* position)
+  {
+    Chunk* chunk=new Chunk;
+    chunk->prev=position;
+    chunk->next=position!=NULL ? position->next : head;
+    if (chunk->next!=NULL)
+      chunk->next->prev=chunk;
+    else
+      tail=chunk;
+    if (position!=NULL)
+      position->next=chunk;
+    else
+      head=chunk;
+    return chunk;
+  }
+
+  void destroyChunk(Chunk* chunk)
+  {
+    if (chunk->prev!=NULL)
+      chunk->prev->next=chunk->next;
+    else
+      head=chunk->next;
+    if (chunk->next!=NULL)
+      chunk->next->prev=chunk->prev;
+    else
+      tail=chunk->prev;
+    destroyRange(chunk->slots(), chunk->count);
+    delete chunk;
+  }
+
+  static Position normalized(Chunk* chunk, size_type index)
+  {
+    if (index==chunk->count)
+      return Position{chunk->next, 0};
+    return Position{chunk, index};
+  }
+
+  // Constructs an element in front of position.
+  template <typename... Args>
+  void emplaceAt(Position position, Args&&... args)
+  {
+    // Built first, as args may refer to an element that is about to move.
+    Type value(std::forward<Args>(args)...);
+    Chunk* chunk=position.chunk;
+    size_type index=position.index;
+    if (chunk==NULL)
+    {
+      chunk=tail;
+      if (chunk==NULL || chunk->count==CAPACITY)
+        chunk=createChunkAfter(tail);
+      index=chunk->count;
+    }
+    else if (chunk->count==CAPACITY && index==0)
+    {
+      // Growing at the front fills a new chunk instead of halving this one.
+      if (chunk->prev==NULL || chunk->prev->count==CAPACITY)
+        chunk=createChunkAfter(chunk->prev);
+      else
+        chunk=chunk->prev;
+      index=chunk->count;
+    }
+    else if (chunk->count==CAPACITY)
+    {
+      Chunk* right=createChunkAfter(chunk);
+      size_type keep=CAPACITY-CAPACITY/2;
+      relocate(chunk->slots()+keep, CAPACITY-keep, right->slots());
+      right->count=CAPACITY-keep;
+      chunk->count=keep;
+      if (index>keep)
+      {
+        chunk=right;
+        index-=keep;
+      }
+    }
+    Type* slots=chunk->slots();
+    relocate(slots+index, chunk->count-index, slots+index+1);
+    new (slots+index) Type(std::move(value));
+    chunk->count++;
+    counter++;
+  }
+
+  // Erases the elements at [from, to) of chunk with one shift of the rest,
+  // leaving the chunk as it is even when it drops below MIN_FILL.
+  void eraseWithin(Chunk* chunk, size_type from, size_type to)
+  {
+    Type* slots=chunk->slots();
+    destroyRange(slots+from, to-from);
+    relocate(slots+to, chunk->count-to, slots+from);
+    chunk->count-=to-from;
+    counter-=to-from;
+  }
+
+  // Brings chunk back to MIN_FILL after an erase, by taking elements from a
+  // neighbour or merging with it, and returns where the element that was at
+  // index is now.
+  Position rebalance(Chunk* chunk, size_type index)
+  {
+    if (chunk->count==0)
+    {
+      Chunk* next=chunk->next;
+      destroyChunk(chunk);
+      return Position{next, 0};
+    }
+    if (chunk->count>=MIN_FILL)
+      return normalized(chunk, index);
+
+    Type* slots=chunk->slots();
+    Chunk* next=chunk->next;
+    if (next!=NULL)
+    {
+      if (chunk->count+next->count<=CAPACITY)
+      {
+        relocate(next->slots(), next->count, slots+chunk->count);
+        chunk->count+=next->count;
+        next->count=0;
+        destroyChunk(next);
+      }
+      else
+      {
+        // next holds more than CAPACITY-MIN_FILL, so it stays at MIN_FILL.
+        size_type moved=MIN_FILL-chunk->count;
+        relocate(next->slots(), moved, slots+chunk->count);
+        chunk->count+=moved;
+        relocate(next->slots()+moved, next->count-moved, next->slots());
+        next->count-=moved;
+      }
+      return normalized(chunk, index);
+    }
+    Chunk* prev=chunk->prev;
+    if (prev==NULL)
+      return normalized(chunk, index);
+    if (prev->count+chunk->count<=CAPACITY)
+    {
+      size_type offset=prev->count;
+      relocate(slots, chunk->count, prev->slots()+offset);
+      prev->count+=chunk->count;
+      chunk->count=0;
+      destroyChunk(chunk);
+      return normalized(prev, offset+index);
+    }
+    size_type moved=MIN_FILL-chunk->count;
+    relocate(slots, chunk->count, slots+moved);
+    relocate(prev->slots()+prev->count-moved, moved, slots);
+    prev->count-=moved;
+    chunk->count+=moved;
+    return normalized(chunk, index+moved);
+  }
+
+  // Erases the element at position and returns where the next one is now.
+  Position eraseAt(Position position)
+  {
+    eraseWithin(position.chunk, position.index, position.index+1);
+    return rebalance(position.chunk, position.index);
+  }
+
+  void clear()
+  {
+    while (head!=NULL)
+      destroyChunk(head);
+    counter=0;
+  }
+
+public:
+  bool isEmpty() const
+  {
+    return counter==0;
+  }
+
+  size_type getSize() const
+  {
+    return counter;
+  }
+
+  void append(const Type& item)
+  {
+    emplaceAt(Position{NULL, 0}, item);
+  }
+
+  void append(Type&& item)
+  {
+    emplaceAt(Position{NULL, 0}, std::move(item));
+  }
+
+  void prepend(const Type& item)
+  {
+    emplaceAt(Position{head, 0}, item);
+  }
+
+  void prepend(Type&& item)
+  {
+    emplaceAt(Position{head, 0}, std::move(item));
+  }
+
+  void insert(const const_iterator& insertPosition, const Type& item)
+  {
+    emplaceAt(Position{insertPosition.chunk, insertPosition.index}, item);
+  }
+
+  void insert(const const_iterator& insertPosition, Type&& item)
+  {
+    emplaceAt(Position{insertPosition.chunk, insertPosition.index}, std::move(item));
+  }
+
+  Type popFirst()
+  {
+    if (isEmpty()) throw std::out_of_range("An attempt to pop first element from empty list was made");
+    Type itemToReturn=std::move(head->slots()[0]);
+    eraseAt(Position{head, 0});
+    return itemToReturn;
+  }
+
+  Type popLast()
+  {
+    if (isEmpty()) throw std::out_of_range("An attempt to pop last element from empty list was made");
+    Type itemToReturn=std::move(tail->slots()[tail->count-1]);
+    eraseAt(Position{tail, tail->count-1});
+    return itemToReturn;
+  }
+
+  void erase(const const_iterator& position)
+  {
+    if (position.chunk==NULL) throw std::out_of_range("An attempt to erase past the last element was made");
+    eraseAt(Position{position.chunk, position.index});
+  }
+
+  // Each chunk the range touches is shifted at most once, and chunks it
+  // covers entirely are freed without touching their neighbours.
+  void erase(const const_iterator& firstIncluded, const const_iterator& lastExcluded)
+  {
+    if (firstIncluded==lastExcluded)
+      return;
+    Chunk* first=firstIncluded.chunk;
+    Chunk* last=lastExcluded.chunk;
+    size_type index=firstIncluded.index;
+    if (first==last)
+    {
+      if (index>lastExcluded.index) throw std::out_of_range("Invalid range");
+      eraseWithin(first, index, lastExcluded.index);
+      rebalance(first, index);
+      return;
+    }
+    if (first==NULL) throw std::out_of_range("Invalid range");
+    for (Chunk* chunk=first->next;chunk!=last;chunk=chunk->next)
+      if (chunk==NULL) throw std::out_of_range("Invalid range");
+
+    eraseWithin(first, index, first->count);
+    while (first->next!=last)
+    {
+      counter-=first->next->count;
+      destroyChunk(first->next);
+    }
+    if (index==0)
+    {
+      destroyChunk(first);
+      first=NULL;
+    }
+    // Rebalancing last never frees first, and leaves last at least half full
+    // even when first then takes elements from it.
+    if (last!=NULL)
+    {
+      eraseWithin(last, 0, lastExcluded.index);
+      rebalance(last, 0);
+    }
+    if (first!=NULL)
+      rebalance(first, index);
+  }
+
+  iterator begin()
+  {
+    return iterator(head, 0, this);
+  }
+
+  iterator end()
+  {
+    return iterator(NULL, 0, this);
+  }
+
+  const_iterator cbegin() const
+  {
+    return const_iterator(head, 0, this);
+  }
+
+  const_iterator cend() const
+  {
+    return const_iterator(NULL, 0, this);
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Type, std::size_t ChunkBytes>
+class UnrolledList<Type, ChunkBytes>::ConstIterator
+{
+  friend UnrolledList<Type, ChunkBytes>;
+public:
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename UnrolledList::value_type;
+  using difference_type = typename UnrolledList::difference_type;
+  using pointer = typename UnrolledList::const_pointer;
+  using reference = typename UnrolledList::const_reference;
+
+private:
+  Chunk* chunk;
+  size_type index;
+  const UnrolledList* list;
+
+  explicit ConstIterator(Chunk* chunk, size_type index, const UnrolledList* list)
+    : chunk(chunk), index(index), list(list)
+  {}
+
+public:
+  ConstIterator() : chunk(NULL), index(0), list(NULL)
+  {}
+
+  reference operator*() const
+  {
+    if (chunk==NULL)
+      throw std::out_of_range("Iterator points past the last element");
+    return chunk->slots()[index];
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  ConstIterator& operator++()
+  {
+    if (chunk==NULL)
+      throw std::out_of_range("Cannot increase iterator");
+    index++;
+    if (index==chunk->count)
+    {
+      chunk=chunk->next;
+      index=0;
+    }
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto result = *this;
+    ++(*this);
+    return result;
+  }
+
+  ConstIterator& operator--()
+  {
+    if (chunk==NULL)
+    {
+      if (list==NULL || list->tail==NULL)
+        throw std::out_of_range("Cannot decrease iterator");
+      chunk=list->tail;
+      index=chunk->count;
+    }
+    else if (index==0)
+    {
+      if (chunk->prev==NULL)
+        throw std::out_of_range("Cannot decrease iterator");
+      chunk=chunk->prev;
+      index=chunk->count;
+    }
+    index--;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto result = *this;
+    --(*this);
+    return result;
+  }
+
+  // Whole chunks are skipped at once.
+  ConstIterator operator+(difference_type d) const
+  {
+    if (d<0)
+      return *this-(-d);
+    ConstIterator itToBeReturned(*this);
+    size_type steps=d;
+    while (steps>0)
+    {
+      if (itToBeReturned.chunk==NULL)
+        throw std::out_of_range("Cannot increase iterator");
+      size_type left=itToBeReturned.chunk->count-itToBeReturned.index;
+      if (steps<left)
+      {
+        itToBeReturned.index+=steps;
+        break;
+      }
+      steps-=left;
+      itToBeReturned.chunk=itToBeReturned.chunk->next;
+      itToBeReturned.index=0;
+    }
+    return itToBeReturned;
+  }
+
+  ConstIterator operator-(difference_type d) const
+  {
+    if (d<0)
+      return *this+(-d);
+    ConstIterator itToBeReturned(*this);
+    size_type steps=d;
+    while (steps>0)
+    {
+      if (itToBeReturned.chunk==NULL)
+      {
+        if (list==NULL || list->tail==NULL)
+          throw std::out_of_range("Cannot decrease iterator");
+        itToBeReturned.chunk=list->tail;
+        itToBeReturned.index=list->tail->count;
+      }
+      if (steps<=itToBeReturned.index)
+      {
+        itToBeReturned.index-=steps;
+        break;
+      }
+      steps-=itToBeReturned.index;
+      if (itToBeReturned.chunk->prev==NULL)
+        throw std::out_of_range("Cannot decrease iterator");
+      itToBeReturned.chunk=itToBeReturned.chunk->prev;
+      itToBeReturned.index=itToBeReturned.chunk->count;
+    }
+    return itToBeReturned;
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return chunk==other.chunk && index==other.index;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return !(*this==other);
+  }
+};
+/////////////////////////////////////////////////////////////////////////
+
+template <typename Type, std::size_t ChunkBytes>
+class UnrolledList<Type, ChunkBytes>::Iterator : public UnrolledList<Type, ChunkBytes>::ConstIterator
+{
+  friend UnrolledList<Type, ChunkBytes>;
+
+  explicit Iterator(Chunk* chunk, size_type index, const UnrolledList* list)
+    : ConstIterator(chunk, index, list)
+  {}
+
+public:
+  using pointer = typename UnrolledList::pointer;
+  using reference = typename UnrolledList::reference;
+
+  Iterator()
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  Iterator operator+(difference_type d) const
+  {
+    return ConstIterator::operator+(d);
+  }
+
+  Iterator operator-(difference_type d) const
+  {
+    return ConstIterator::operator-(d);
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+};
+
+}
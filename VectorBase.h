@@ -0,0 +1,856 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Defining LINEAR_CHECKED_ITERATORS to 1 makes Vector and SmallVector
+// iterators and operator[] check every step and access against the
+// container's bounds and throw std::out_of_range. By default they are
+// unchecked and cost no more than raw pointers. Checked iterators also
+// carry a pointer to their container, so the setting changes the layout
+// of the iterator classes: every translation unit of a program must use
+// the same value. It deliberately does not follow NDEBUG, which commonly
+// differs between translation units.
+#if !defined(LINEAR_CHECKED_ITERATORS)
+#define LINEAR_CHECKED_ITERATORS 0
+#endif
+
+namespace Linear
+{
+
+// Everything Vector and SmallVector share: element storage described by
+// array, currentSize and maxSize, and all operations on it. Derived
+// supplies its inline buffer through INLINE_CAPACITY and inlineArray();
+// with an INLINE_CAPACITY of 0 the storage always lives on the heap.
+// Derived's destructor calls releaseStorage().
+template <typename Type, typename Derived>
+class VectorBase
+{
+public:
+  using difference_type = std::ptrdiff_t;
+  using size_type = std::size_t;
+  using value_type = Type;
+  using pointer = Type*;
+  using reference = Type&;
+  using const_pointer = const Type*;
+  using const_reference = const Type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+protected:
+  // Trivially copyable elements are relocated by memcpy, so their heap
+  // storage comes from malloc and can grow in place through realloc.
+  static constexpr bool REALLOCATABLE = std::is_trivially_copyable<Type>::value &&
+                                        alignof(Type)<=alignof(std::max_align_t);
+
+  size_type maxSize;
+  size_type currentSize;
+  Type* array;//raw storage; only the first currentSize slots hold objects
+
+  VectorBase():maxSize(0), currentSize(0), array(NULL)
+  {}
+
+  VectorBase(const VectorBase&) = delete;
+  VectorBase& operator=(const VectorBase&) = delete;
+
+  ~VectorBase()
+  {}
+
+  Derived& derived()
+  {
+    return static_cast<Derived&>(*this);
+  }
+
+  const Derived& derived() const
+  {
+    return static_cast<const Derived&>(*this);
+  }
+
+  // Starts out in the inline buffer, if there is one.
+  void useInlineStorage()
+  {
+    array=derived().inlineArray();
+    maxSize=Derived::INLINE_CAPACITY;
+  }
+
+  bool isInline() const
+  {
+    return Derived::INLINE_CAPACITY!=0 && array==derived().inlineArray();
+  }
+
+  void releaseStorage()
+  {
+    destroyRange(array, currentSize);
+    if (!isInline())
+      deallocate(array);
+  }
+
+  void copyFrom(const VectorBase& other)
+  {
+    if (this==&other)
+      return;
+    clear();
+    if (maxSize<other.currentSize)
+    {
+      Type* newArray=allocate(other.currentSize);
+      if (!isInline())
+        deallocate(array);
+      array=newArray;
+      maxSize=other.currentSize;
+    }
+    copyRange(other.array, other.currentSize, array);
+    currentSize=other.currentSize;
+  }
+
+  // Heap storage is taken over; inline elements have to be moved one by one.
+  void moveFrom(VectorBase& other)
+  {
+    if (this==&other)
+      return;
+    clear();
+    if (!other.isInline())
+    {
+      if (!isInline())
+        deallocate(array);
+      maxSize=other.maxSize;
+      currentSize=other.currentSize;
+      array=other.array;
+
+      other.currentSize=0;
+      other.useInlineStorage();
+      return;
+    }
+    transferRange(other.array, other.currentSize, array);
+    currentSize=other.currentSize;
+    other.clear();
+  }
+
+  static Type* allocate(size_type n)
+  {
+    if (n>std::numeric_limits<size_type>::max()/sizeof(Type))
+      throw std::length_error("Vector capacity overflow");
+    if (REALLOCATABLE)
+    {
+      void* memory=std::malloc(n*sizeof(Type));
+      if (memory==NULL)
+        throw std::bad_alloc();
+      return static_cast<Type*>(memory);
+    }
+#if defined(__cpp_aligned_new)
+    if (alignof(Type)>__STDCPP_DEFAULT_NEW_ALIGNMENT__)
+      return static_cast<Type*>(::operator new(n*sizeof(Type), std::align_val_t(alignof(Type))));
+#else
+    static_assert(alignof(Type)<=alignof(std::max_align_t), "Over-aligned elements need C++17 aligned new");
+#endif
+    return static_cast<Type*>(::operator new(n*sizeof(Type)));
+  }
+
+  static void deallocate(Type* memory)
+  {
+    if (REALLOCATABLE)
+    {
+      std::free(memory);
+      return;
+    }
+#if defined(__cpp_aligned_new)
+    if (alignof(Type)>__STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    {
+      ::operator delete(memory, std::align_val_t(alignof(Type)));
+      return;
+    }
+#endif
+    ::operator delete(memory);
+  }
+
+  static void destroyRange(Type* first, size_type n)
+  {
+    if (!std::is_trivially_destructible<Type>::value)
+      for (size_type i=0;i<n;i++)
+        first[i].~Type();
+  }
+
+  // Copy-constructs n elements into raw storage; on failure the copies
+  // made so far are destroyed.
+  static void copyRange(const Type* from, size_type n, Type* to)
+  {
+    if (std::is_trivially_copyable<Type>::value)
+    {
+      if (n!=0)
+        std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), n*sizeof(Type));
+      return;
+    }
+    size_type i=0;
+    try
+    {
+      for (;i<n;i++)
+        new (to+i) Type(from[i]);
+    }
+    catch (...)
+    {
+      destroyRange(to, i);
+      throw;
+    }
+  }
+
+  // Moves n elements into raw storage, or copies them if moving could throw,
+  // so a failure leaves the sources intact. The caller destroys the sources.
+  static void transferRange(Type* from, size_type n, Type* to)
+  {
+    if (std::is_trivially_copyable<Type>::value)
+    {
+      if (n!=0)
+        std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), n*sizeof(Type));
+      return;
+    }
+    size_type i=0;
+    try
+    {
+      for (;i<n;i++)
+        new (to+i) Type(std::move_if_noexcept(from[i]));
+    }
+    catch (...)
+    {
+      destroyRange(to, i);
+      throw;
+    }
+  }
+
+  size_type grownCapacity() const
+  {
+    if (maxSize==0)
+      return 4;
+    if (maxSize>std::numeric_limits<size_type>::max()/2)
+      throw std::length_error("Vector capacity overflow");
+    return 2*maxSize;
+  }
+
+  // Moves the elements to storage of the given capacity (not below the
+  // size); capacities that fit the inline buffer use it.
+  void reallocate(size_type capacity)
+  {
+    if (REALLOCATABLE && capacity>Derived::INLINE_CAPACITY && !isInline())
+    {
+      if (capacity>std::numeric_limits<size_type>::max()/sizeof(Type))
+        throw std::length_error("Vector capacity overflow");
+      void* memory=std::realloc(static_cast<void*>(array), capacity*sizeof(Type));
+      if (memory==NULL)
+        throw std::bad_alloc();
+      array=static_cast<Type*>(memory);
+      maxSize=capacity;
+      return;
+    }
+    if (capacity==0)
+    {
+      // Only reached without inline storage and without elements.
+      releaseStorage();
+      useInlineStorage();
+      return;
+    }
+    bool toInline= capacity<=Derived::INLINE_CAPACITY;
+    if (toInline && isInline())
+      return;
+    Type* newArray= toInline ? derived().inlineArray() : allocate(capacity);
+    try
+    {
+      transferRange(array, currentSize, newArray);
+    }
+    catch (...)
+    {
+      if (!toInline)
+        deallocate(newArray);
+      throw;
+    }
+    destroyRange(array, currentSize);
+    if (!isInline())
+      deallocate(array);
+    array=newArray;
+    maxSize= toInline ? Derived::INLINE_CAPACITY : capacity;
+  }
+
+  // Constructs an element from args at position, shifting the tail right.
+  template <typename... Args>
+  void emplaceAt(size_type position, Args&&... args)
+  {
+    if (currentSize==maxSize && (!REALLOCATABLE || isInline()))
+    {
+      // The new element is built first, as args may refer into the old storage.
+      size_type newCapacity=grownCapacity();
+      Type* newArray=allocate(newCapacity);
+      try
+      {
+        new (newArray+position) Type(std::forward<Args>(args)...);
+      }
+      catch (...)
+      {
+        deallocate(newArray);
+        throw;
+      }
+      try
+      {
+        transferRange(array, position, newArray);
+      }
+      catch (...)
+      {
+        newArray[position].~Type();
+        deallocate(newArray);
+        throw;
+      }
+      try
+      {
+        transferRange(array+position, currentSize-position, newArray+position+1);
+      }
+      catch (...)
+      {
+        destroyRange(newArray, position+1);
+        deallocate(newArray);
+        throw;
+      }
+      destroyRange(array, currentSize);
+      if (!isInline())
+        deallocate(array);
+      array=newArray;
+      maxSize=newCapacity;
+      currentSize++;
+      return;
+    }
+    if (currentSize==maxSize || position!=currentSize)
+    {
+      Type value(std::forward<Args>(args)...);
+      if (currentSize==maxSize)
+        reallocate(grownCapacity());
+      placeAt(position, std::move(value));
+      return;
+    }
+    new (array+currentSize) Type(std::forward<Args>(args)...);
+    currentSize++;
+  }
+
+  size_type indexOf(const const_iterator& it) const
+  {
+#if LINEAR_CHECKED_ITERATORS
+    if (it.container!=this || it.current<array || it.current>array+currentSize)
+      throw std::out_of_range("Iterator out of range");
+#endif
+    return it.current-array;
+  }
+
+  // Shifts the tail right by one and moves value into the gap; capacity
+  // must be available.
+  void placeAt(size_type position, Type&& value)
+  {
+    if (position==currentSize)
+    {
+      new (array+currentSize) Type(std::move(value));
+      currentSize++;
+      return;
+    }
+    if (std::is_trivially_copyable<Type>::value)
+    {
+      std::memmove(static_cast<void*>(array+position+1), static_cast<const void*>(array+position),
+                   (currentSize-position)*sizeof(Type));
+      new (array+position) Type(std::move(value));
+      currentSize++;
+      return;
+    }
+    new (array+currentSize) Type(std::move(array[currentSize-1]));
+    currentSize++;
+    for (size_type i=currentSize-2;i>position;i--)
+      array[i]=std::move(array[i-1]);
+    array[position]=std::move(value);
+  }
+
+public:
+
+  bool isEmpty() const
+  {
+    return currentSize==0;
+  }
+
+  size_type getSize() const
+  {
+    return currentSize;
+  }
+
+  size_type getCapacity() const
+  {
+    return maxSize;
+  }
+
+  reference operator[](size_type index)
+  {
+#if LINEAR_CHECKED_ITERATORS
+    if (index>=currentSize)
+      throw std::out_of_range("Index out of range");
+#endif
+    return array[index];
+  }
+
+  const_reference operator[](size_type index) const
+  {
+#if LINEAR_CHECKED_ITERATORS
+    if (index>=currentSize)
+      throw std::out_of_range("Index out of range");
+#endif
+    return array[index];
+  }
+
+  // Checked regardless of LINEAR_CHECKED_ITERATORS.
+  reference at(size_type index)
+  {
+    if (index>=currentSize)
+      throw std::out_of_range("Index out of range");
+    return array[index];
+  }
+
+  const_reference at(size_type index) const
+  {
+    if (index>=currentSize)
+      throw std::out_of_range("Index out of range");
+    return array[index];
+  }
+
+  pointer data()
+  {
+    return array;
+  }
+
+  const_pointer data() const
+  {
+    return array;
+  }
+
+  template <typename InputIterator,
+            typename = typename std::iterator_traits<InputIterator>::iterator_category>
+  void assign(InputIterator first, InputIterator last)
+  {
+    clear();
+    using Category = typename std::iterator_traits<InputIterator>::iterator_category;
+    if (std::is_base_of<std::forward_iterator_tag, Category>::value)
+      reserve(std::distance(first, last));
+    for (;first!=last;++first)
+      append(*first);
+  }
+
+  void reserve(size_type capacity)
+  {
+    if (capacity>maxSize)
+      reallocate(capacity);
+  }
+
+  // Returns to the inline buffer, if there is one, when the elements fit.
+  void shrink_to_fit()
+  {
+    if (maxSize>currentSize && !isInline())
+      reallocate(currentSize);
+  }
+
+  // Destroys the elements but keeps the storage.
+  void clear()
+  {
+    destroyRange(array, currentSize);
+    currentSize=0;
+  }
+
+  void append(const Type& item)
+  {
+    emplaceAt(currentSize, item);
+  }
+
+  void append(Type&& item)
+  {
+    emplaceAt(currentSize, std::move(item));
+  }
+
+  template <typename... Args>
+  reference emplace_back(Args&&... args)
+  {
+    emplaceAt(currentSize, std::forward<Args>(args)...);
+    return array[currentSize-1];
+  }
+
+  void prepend(const Type& item)
+  {
+    emplaceAt(0, item);
+  }
+
+  void prepend(Type&& item)
+  {
+    emplaceAt(0, std::move(item));
+  }
+
+  void insert(const const_iterator& insertPosition, const Type& item)
+  {
+    emplaceAt(indexOf(insertPosition), item);
+  }
+
+  void insert(const const_iterator& insertPosition, Type&& item)
+  {
+    emplaceAt(indexOf(insertPosition), std::move(item));
+  }
+
+  template <typename... Args>
+  iterator emplace(const const_iterator& position, Args&&... args)
+  {
+    size_type index=indexOf(position);
+    emplaceAt(index, std::forward<Args>(args)...);
+    return iterator(array+index, *this);
+  }
+
+  Type popFirst()
+  {
+    if (isEmpty()) throw std::logic_error("Colection is empty. Cannot pop first element.");
+    Type toReturn=std::move(array[0]);
+    erase(begin(),++begin());
+    return toReturn;
+  }
+
+  Type popLast()
+  {
+    if (isEmpty()) throw std::logic_error("Colection is empty. Cannot pop last element.ss");
+    Type toReturn=std::move(array[currentSize-1]);
+    currentSize--;
+    array[currentSize].~Type();
+    return toReturn;
+  }
+
+  void erase(const const_iterator& position)
+  {
+    const_iterator it=position;
+    erase(position, ++it);
+  }
+
+  void erase(const const_iterator& firstIncluded, const const_iterator& lastExcluded)
+  {
+    size_type toWrite=indexOf(firstIncluded);
+    size_type from=indexOf(lastExcluded);
+    if (from<toWrite)
+      throw std::out_of_range("Iterator out of range");
+    size_type numberOfErasedElements=from-toWrite;
+    if (numberOfErasedElements==0)
+      return;
+
+    if (std::is_trivially_copyable<Type>::value)
+    {
+      std::memmove(static_cast<void*>(array+toWrite), static_cast<const void*>(array+from),
+                   (currentSize-from)*sizeof(Type));
+      currentSize-=numberOfErasedElements;
+      return;
+    }
+    while (from<currentSize)
+    {
+      array[toWrite]=std::move(array[from]);
+      toWrite++;
+      from++;
+    }
+    destroyRange(array+toWrite, numberOfErasedElements);
+    currentSize-=numberOfErasedElements;
+  }
+
+  iterator begin()
+  {
+    return iterator (array, *this);
+  }
+
+  iterator end()//iterator points at element following the last element
+  {
+    return iterator (array+currentSize, *this);
+  }
+
+  const_iterator cbegin() const
+  {
+    return const_iterator (array, *this);
+  }
+
+  const_iterator cend() const
+  {
+    return const_iterator (array+currentSize, *this);
+
+  }
+
+  const_iterator begin() const
+  {
+    return cbegin();
+  }
+
+  const_iterator end() const
+  {
+    return cend();
+  }
+};
+////////////////////////////////////////////////////////////////////////////////
+template <typename Type, typename Derived>
+class VectorBase<Type, Derived>::ConstIterator
+{
+  friend VectorBase<Type, Derived>;
+public:
+  using iterator_category = std::random_access_iterator_tag;
+#if __cplusplus >= 202002L
+  using iterator_concept = std::contiguous_iterator_tag;
+#endif
+  using value_type = typename VectorBase::value_type;
+  using difference_type = typename VectorBase::difference_type;
+  using pointer = typename VectorBase::const_pointer;
+  using reference = typename VectorBase::const_reference;
+
+private:
+  Type* current;
+#if LINEAR_CHECKED_ITERATORS
+  const VectorBase* container;
+#endif
+
+  // Throws unless moving by d stays within [begin, end].
+  void checkStep(difference_type d) const
+  {
+#if LINEAR_CHECKED_ITERATORS
+    difference_type position=current-container->array+d;
+    if (position<0 || position>static_cast<difference_type>(container->currentSize))
+      throw std::out_of_range("Iterator out of range");
+#else
+    (void)d;
+#endif
+  }
+
+  // Throws unless there is an element d positions away.
+  void checkAccess(difference_type d) const
+  {
+#if LINEAR_CHECKED_ITERATORS
+    difference_type position=current-container->array+d;
+    if (position<0 || position>=static_cast<difference_type>(container->currentSize))
+      throw std::out_of_range("Iterator out of range");
+#else
+    (void)d;
+#endif
+  }
+
+public:
+#if LINEAR_CHECKED_ITERATORS
+  ConstIterator() : current(NULL), container(NULL){}
+
+  explicit ConstIterator(Type* current,const VectorBase& container)
+                        : current(current), container(&container){}
+
+  explicit ConstIterator(const VectorBase& container)
+                        : current(NULL), container(&container){}
+#else
+  ConstIterator() : current(NULL){}
+
+  explicit ConstIterator(Type* current,const VectorBase&)
+                        : current(current){}
+
+  explicit ConstIterator(const VectorBase&)
+                        : current(NULL){}
+#endif
+
+  reference operator*() const
+  {
+    checkAccess(0);
+    return *current;
+  }
+
+  // Only forms the address, so std::to_address works on end() as well.
+  pointer operator->() const
+  {
+    return current;
+  }
+
+  reference operator[](difference_type d) const
+  {
+    checkAccess(d);
+    return current[d];
+  }
+
+  ConstIterator& operator++()
+  {
+    checkStep(1);
+    this->current++;
+    return *this;
+  }
+
+  ConstIterator operator++(int)
+  {
+    auto result = *this;
+    ++(*this);
+    return result;
+  }
+
+  ConstIterator& operator--()
+  {
+    checkStep(-1);
+    this->current--;
+    return *this;
+  }
+
+  ConstIterator operator--(int)
+  {
+    auto result = *this;
+    --(*this);
+    return result;
+  }
+
+  ConstIterator& operator+=(difference_type d)
+  {
+    checkStep(d);
+    current+=d;
+    return *this;
+  }
+
+  ConstIterator& operator-=(difference_type d)
+  {
+    return *this+=-d;
+  }
+
+  ConstIterator operator+(difference_type d) const
+  {
+    ConstIterator toReturn (*this);
+    return toReturn+=d;
+  }
+
+  ConstIterator operator-(difference_type d) const
+  {
+    ConstIterator toReturn (*this);
+    return toReturn-=d;
+  }
+
+  difference_type operator-(const ConstIterator& other) const
+  {
+    return current-other.current;
+  }
+
+  bool operator==(const ConstIterator& other) const
+  {
+    return current==other.current;
+  }
+
+  bool operator!=(const ConstIterator& other) const
+  {
+    return this->current!=other.current;
+  }
+
+  bool operator<(const ConstIterator& other) const
+  {
+    return current<other.current;
+  }
+
+  bool operator>(const ConstIterator& other) const
+  {
+    return other<*this;
+  }
+
+  bool operator<=(const ConstIterator& other) const
+  {
+    return !(other<*this);
+  }
+
+  bool operator>=(const ConstIterator& other) const
+  {
+    return !(*this<other);
+  }
+
+  friend ConstIterator operator+(difference_type d, const ConstIterator& it)
+  {
+    return it+d;
+  }
+};
+/////////////////////////////////////////////////////////////////////////////////
+template <typename Type, typename Derived>
+class VectorBase<Type, Derived>::Iterator : public VectorBase<Type, Derived>::ConstIterator
+{
+public:
+  using pointer = typename VectorBase::pointer;
+  using reference = typename VectorBase::reference;
+
+  Iterator(){}
+
+  explicit Iterator(Type* current, VectorBase& container)
+  : ConstIterator(current, container){}
+
+  Iterator(const ConstIterator& other)
+  : ConstIterator(other){}
+
+  explicit Iterator( const VectorBase& container)
+  : ConstIterator(container){}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  Iterator& operator+=(difference_type d)
+  {
+    ConstIterator::operator+=(d);
+    return *this;
+  }
+
+  Iterator& operator-=(difference_type d)
+  {
+    ConstIterator::operator-=(d);
+    return *this;
+  }
+
+  Iterator operator+(difference_type d) const
+  {
+    return ConstIterator::operator+(d);
+  }
+
+  Iterator operator-(difference_type d) const
+  {
+    return ConstIterator::operator-(d);
+  }
+
+  using ConstIterator::operator-;
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+
+  pointer operator->() const
+  {
+    return const_cast<pointer>(ConstIterator::operator->());
+  }
+
+  reference operator[](difference_type d) const
+  {
+    return const_cast<reference>(ConstIterator::operator[](d));
+  }
+
+  friend Iterator operator+(difference_type d, const Iterator& it)
+  {
+    return it+d;
+  }
+};
+
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <thread>
+
+#include "Algorithms.h"
+#include "Vector.h"
+#include "Bench.h"
+
+// Bandwidth of the bulk algorithms, serial and parallel, against the loops
+// over Vector iterators they replace. Built twice: AlgorithmsBenchChecked
+// defines LINEAR_CHECKED_ITERATORS, so its loops pay for checked iterators.
+
+namespace
+{
+
+using namespace Linear;
+
+template <typename Type>
+void measure(const char* typeName, std::size_t size)
+{
+  Algorithms::Parallel parallel;
+  Vector<Type> data;
+  std::mt19937_64 random(1);
+  for (std::size_t i=0;i<size;i++)
+    data.append(static_cast<Type>(random()%1000));
+  double bytes=static_cast<double>(size)*sizeof(Type);
+  char name[128];
+
+  auto row=[&](const char* operation, const char* variant, double seconds, double traffic) {
+    std::snprintf(name, sizeof(name), "%s<%s>, %s", operation, typeName, variant);
+    Bench::reportBandwidth(name, seconds, traffic);
+  };
+
+  row("reduce", "iterator loop", Bench::bestOf(3, [&] {
+    Type sum=0;
+    for (auto it=data.begin();it!=data.end();++it)
+      sum+=*it;
+    Bench::keep(sum);
+  }), bytes);
+  row("reduce", "serial", Bench::bestOf(3, [&] { Bench::keep(Algorithms::reduce(data, Type(0))); }), bytes);
+  row("reduce", "parallel", Bench::bestOf(3, [&] { Bench::keep(Algorithms::reduce(parallel, data, Type(0))); }), bytes);
+
+  // Looks for a value that is not there, so the whole range is read.
+  Type absent=static_cast<Type>(-1);
+  row("find", "iterator loop", Bench::bestOf(3, [&] {
+    auto it=data.begin();
+    while (it!=data.end() && *it!=absent)
+      ++it;
+    Bench::keep(it);
+  }), bytes);
+  row("find", "serial", Bench::bestOf(3, [&] { Bench::keep(Algorithms::find(data, absent)); }), bytes);
+  row("find", "parallel", Bench::bestOf(3, [&] { Bench::keep(Algorithms::find(parallel, data, absent)); }), bytes);
+
+  auto increment=[](Type x) { return x+1; };
+  row("transform", "iterator loop", Bench::bestOf(3, [&] {
+    for (auto it=data.begin();it!=data.end();++it)
+      *it=increment(*it);
+  }), 2*bytes);
+  row("transform", "serial", Bench::bestOf(3, [&] { Algorithms::transform(data, increment); }), 2*bytes);
+  row("transform", "parallel", Bench::bestOf(3, [&] { Algorithms::transform(parallel, data, increment); }), 2*bytes);
+
+  row("fill", "iterator loop", Bench::bestOf(3, [&] {
+    for (auto it=data.begin();it!=data.end();++it)
+      *it=Type(3);
+  }), bytes);
+  row("fill", "serial", Bench::bestOf(3, [&] { Algorithms::fill(data, Type(3)); }), bytes);
+  row("fill", "parallel", Bench::bestOf(3, [&] { Algorithms::fill(parallel, data, Type(3)); }), bytes);
+
+  // Sorting rates count the bytes sorted, not the bytes moved.
+  Vector<Type> unsorted;
+  for (std::size_t i=0;i<size;i++)
+    unsorted.append(static_cast<Type>(random()));
+  auto sortTime=[&](std::function<void(Vector<Type>&)> sort) {
+    double best=0;
+    for (int run=0;run<3;run++)
+    {
+      Vector<Type> copy(unsorted);
+      double elapsed=Bench::seconds([&] { sort(copy); });
+      if (run==0 || elapsed<best)
+        best=elapsed;
+    }
+    return best;
+  };
+  row("sort", "std::sort over iterators", sortTime([](Vector<Type>& v) { std::sort(v.begin(), v.end()); }), bytes);
+  row("sort", "serial", sortTime([](Vector<Type>& v) { Algorithms::sort(v); }), bytes);
+  row("sort", "parallel", sortTime([&](Vector<Type>& v) { Algorithms::sort(parallel, v); }), bytes);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t size=Bench::sizeArgument(argc, argv, 1<<23);
+  std::printf("hardware threads: %u, checked iterators: %d\n", std::thread::hardware_concurrency(),
+              LINEAR_CHECKED_ITERATORS);
+  measure<double>("double", size);
+  measure<std::int64_t>("int64", size);
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "BTreeMap.h"
+#include "TreeMap.h"
+#include "Bench.h"
+
+// BTreeMap against the red-black TreeMap, with std::map for reference, on
+// random lookups, in-order scans and a mix of inserts and removals.
+
+namespace
+{
+
+using Key = std::uint64_t;
+
+template <typename Map>
+void measure(const char* mapName, const std::vector<Key>& keys)
+{
+  char name[128];
+  std::size_t n=keys.size();
+  Map map;
+  double seconds=Bench::bestOf(1, [&] {
+    for (std::size_t i=0;i<n;i++)
+      map[keys[i]]=i;
+  });
+  std::snprintf(name, sizeof(name), "%s, random inserts", mapName);
+  Bench::report(name, seconds, n);
+
+  std::vector<Key> probes(keys);
+  std::shuffle(probes.begin(), probes.end(), std::mt19937(1));
+  seconds=Bench::bestOf(3, [&] {
+    std::size_t sum=0;
+    for (Key key : probes)
+      sum+=map.find(key)->second;
+    Bench::keep(sum);
+  });
+  std::snprintf(name, sizeof(name), "%s, random lookups", mapName);
+  Bench::report(name, seconds, n);
+
+  seconds=Bench::bestOf(3, [&] {
+    std::size_t sum=0;
+    for (auto it=map.begin();it!=map.end();++it)
+      sum+=it->second;
+    Bench::keep(sum);
+  });
+  std::snprintf(name, sizeof(name), "%s, in-order scan", mapName);
+  Bench::report(name, seconds, n);
+
+  // Each step removes one present key and inserts a new one, so the size
+  // stays the same.
+  std::mt19937_64 random(2);
+  seconds=Bench::bestOf(1, [&] {
+    for (std::size_t i=0;i<n;i++)
+    {
+      std::size_t victim=random()%n;
+      map.remove(probes[victim]);
+      probes[victim]=2*random()+1;
+      map[probes[victim]]=i;
+    }
+  });
+  std::snprintf(name, sizeof(name), "%s, mixed remove and insert", mapName);
+  Bench::report(name, seconds, 2*n);
+}
+
+// std::map spelled like the library's maps.
+template <typename KeyType, typename ValueType>
+struct StdMap : std::map<KeyType, ValueType>
+{
+  void remove(const KeyType& key)
+  {
+    this->erase(key);
+  }
+};
+
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t size=Bench::sizeArgument(argc, argv, 1<<20);
+  std::mt19937_64 random(3);
+  std::vector<Key> keys;
+  // Even keys, so that the odd ones inserted later are new.
+  for (std::size_t i=0;i<size;i++)
+    keys.push_back(2*random());
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  std::shuffle(keys.begin(), keys.end(), random);
+
+  measure<Maps::BTreeMap<Key, Key>>("BTreeMap", keys);
+  measure<Maps::TreeMap<Key, Key>>("TreeMap", keys);
+  measure<StdMap<Key, Key>>("std::map", keys);
+  return 0;
+}
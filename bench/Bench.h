@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal timing helpers shared by the benchmarks.
+namespace Bench
+{
+
+template <typename Task>
+double seconds(Task task)
+{
+  auto start=std::chrono::steady_clock::now();
+  task();
+  std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-start;
+  return elapsed.count();
+}
+
+// Seconds taken by the fastest of runs calls of task.
+template <typename Task>
+double bestOf(int runs, Task task)
+{
+  double best=0;
+  for (int run=0;run<runs;run++)
+  {
+    double elapsed=seconds(task);
+    if (run==0 || elapsed<best)
+      best=elapsed;
+  }
+  return best;
+}
+
+// Keeps the optimizer from dropping the computation of value.
+template <typename Type>
+void keep(const Type& value)
+{
+#if defined(__GNUC__)
+  asm volatile("" : : "r"(&value) : "memory");
+#else
+  static const void* volatile sink;
+  sink=&value;
+#endif
+}
+
+inline void report(const char* name, double seconds, double operations)
+{
+  std::printf("%-48s %10.2f ns/op %10.2f Mop/s\n", name, seconds*1e9/operations, operations/seconds/1e6);
+}
+
+inline void reportTime(const char* name, double seconds)
+{
+  std::printf("%-48s %10.3f ms\n", name, seconds*1e3);
+}
+
+inline void reportBandwidth(const char* name, double seconds, double bytes)
+{
+  std::printf("%-48s %10.3f ms %10.2f GB/s\n", name, seconds*1e3, bytes/seconds/1e9);
+}
+
+// The first command line argument, if any, overrides the problem size.
+inline std::size_t sizeArgument(int argc, char** argv, std::size_t size)
+{
+  if (argc>1)
+    size=std::strtoull(argv[1], NULL, 10);
+  return size;
+}
+
+}
@@ -0,0 +1,91 @@
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentHashMap.h"
+#include "HashMap.h"
+#include "Bench.h"
+
+// Throughput of ConcurrentHashMap against one HashMap behind one mutex,
+// which is how the services shared a HashMap between threads before, from 1
+// to 64 threads and for several shares of reads.
+
+namespace
+{
+
+using Key = std::uint64_t;
+
+class LockedHashMap
+{
+  std::mutex lock;
+  Maps::HashMap<Key, Key> map;
+
+public:
+  bool contains(Key key)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    return map.find(key)!=map.end();
+  }
+
+  void insert_or_assign(Key key, Key value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    map.insert_or_assign(key, value);
+  }
+};
+
+// Every thread runs operations lookups or assignments of random keys, half
+// of which are present at the start.
+template <typename Map>
+double run(Map& map, unsigned threads, unsigned readPercent, std::size_t keys, std::size_t operations)
+{
+  return Bench::bestOf(3, [&] {
+    std::vector<std::thread> workers;
+    for (unsigned thread=0;thread<threads;thread++)
+      workers.emplace_back([&map, thread, readPercent, keys, operations] {
+        std::mt19937_64 random(thread);
+        std::size_t found=0;
+        for (std::size_t i=0;i<operations;i++)
+        {
+          Key key=random()%(2*keys);
+          if (random()%100<readPercent)
+            found+=map.contains(key);
+          else
+            map.insert_or_assign(key, i);
+        }
+        Bench::keep(found);
+      });
+    for (std::thread& worker : workers)
+      worker.join();
+  });
+}
+
+template <typename Map>
+void scale(const char* mapName, std::size_t keys, std::size_t operations)
+{
+  char name[128];
+  for (unsigned readPercent : {50u, 90u, 99u})
+    for (unsigned threads=1;threads<=64;threads*=2)
+    {
+      Map map;
+      for (Key key=0;key<2*keys;key+=2)
+        map.insert_or_assign(key, key);
+      double seconds=run(map, threads, readPercent, keys, operations);
+      std::snprintf(name, sizeof(name), "%s, %u%% reads, %u threads", mapName, readPercent, threads);
+      Bench::report(name, seconds, static_cast<double>(threads)*operations);
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t keys=Bench::sizeArgument(argc, argv, 1<<18);
+  std::size_t operations=1<<18;
+  std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+  scale<Maps::ConcurrentHashMap<Key, Key>>("ConcurrentHashMap", keys, operations);
+  scale<LockedHashMap>("HashMap behind a mutex", keys, operations);
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentQueue.h"
+#include "ConcurrentStack.h"
+#include "LinkedList.h"
+#include "Bench.h"
+
+// Throughput of ConcurrentQueue and ConcurrentStack against one LinkedList
+// behind one mutex, which is how work queues were shared before, from 1 to
+// 64 threads. Half of the threads produce and half consume; a single thread
+// does both in turn.
+
+namespace
+{
+
+using Value = std::uint64_t;
+
+class LockedQueue
+{
+  std::mutex lock;
+  Linear::LinkedList<Value> list;
+
+public:
+  void append(Value value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    list.append(value);
+  }
+
+  bool tryPopFirst(Value& value)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (list.isEmpty())
+      return false;
+    value=list.popFirst();
+    return true;
+  }
+};
+
+// Adapts the stack to the queue's interface.
+class Stack
+{
+  Linear::ConcurrentStack<Value> stack;
+
+public:
+  void append(Value value)
+  {
+    stack.append(value);
+  }
+
+  bool tryPopFirst(Value& value)
+  {
+    return stack.tryPopLast(value);
+  }
+};
+
+// Producers append operations values each, consumers pop until all of them
+// are gone.
+template <typename Queue>
+double run(unsigned threads, std::size_t operations)
+{
+  return Bench::bestOf(3, [&] {
+    Queue queue;
+    unsigned producers=threads==1 ? 1 : threads/2;
+    unsigned consumers=threads==1 ? 1 : threads-producers;
+    if (threads==1)
+    {
+      Value value;
+      for (std::size_t i=0;i<operations;i++)
+      {
+        queue.append(i);
+        queue.tryPopFirst(value);
+      }
+      return;
+    }
+    std::atomic<std::size_t> remaining(producers*operations);
+    std::vector<std::thread> workers;
+    for (unsigned producer=0;producer<producers;producer++)
+      workers.emplace_back([&queue, operations] {
+        for (std::size_t i=0;i<operations;i++)
+          queue.append(i);
+      });
+    for (unsigned consumer=0;consumer<consumers;consumer++)
+      workers.emplace_back([&queue, &remaining] {
+        Value value;
+        while (remaining.load(std::memory_order_relaxed)>0)
+          if (queue.tryPopFirst(value))
+            remaining.fetch_sub(1, std::memory_order_relaxed);
+          else
+            std::this_thread::yield();
+      });
+    for (std::thread& worker : workers)
+      worker.join();
+  });
+}
+
+template <typename Queue>
+void scale(const char* queueName, std::size_t operations)
+{
+  char name[128];
+  for (unsigned threads=1;threads<=64;threads*=2)
+  {
+    double seconds=run<Queue>(threads, operations);
+    unsigned producers=threads==1 ? 1 : threads/2;
+    std::snprintf(name, sizeof(name), "%s, %u threads", queueName, threads);
+    // One operation is an append and its pop.
+    Bench::report(name, seconds, static_cast<double>(producers)*operations);
+  }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t operations=Bench::sizeArgument(argc, argv, 1<<18);
+  std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+  scale<Linear::ConcurrentQueue<Value>>("ConcurrentQueue", operations);
+  scale<Stack>("ConcurrentStack", operations);
+  scale<LockedQueue>("LinkedList behind a mutex", operations);
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "HashMap.h"
+#include "Bench.h"
+
+// Lookups in Maps::HashMap against std::unordered_map, a chained table that
+// walks a bucket list per lookup like HashMap did before control-byte
+// probing. Built twice: HashMapBench probes with SIMD where the target
+// allows, HashMapBenchScalar with the portable loop.
+
+namespace
+{
+
+#if defined(MAPS_HASHMAP_AVX2_PROBING)
+const char* const PROBING = "AVX2";
+#elif defined(MAPS_HASHMAP_SSE2_PROBING)
+const char* const PROBING = "SSE2";
+#else
+const char* const PROBING = "scalar";
+#endif
+
+template <typename Map, typename Key>
+void lookups(const char* mapName, const char* keyName, const std::vector<Key>& present,
+             const std::vector<Key>& absent)
+{
+  Map map;
+  for (std::size_t i=0;i<present.size();i++)
+    map[present[i]]=i;
+
+  std::vector<Key> hits(present);
+  std::shuffle(hits.begin(), hits.end(), std::mt19937(1));
+  char name[128];
+  for (int missPercent : {0, 50, 100})
+  {
+    // Every lookup either hits or misses, mixed in the given proportion.
+    std::vector<const Key*> probes;
+    std::mt19937 random(2);
+    for (std::size_t i=0;i<hits.size();i++)
+      probes.push_back(random()%100<static_cast<unsigned>(missPercent) ? &absent[i] : &hits[i]);
+    std::size_t found=0;
+    double seconds=Bench::bestOf(3, [&] {
+      for (const Key* key : probes)
+        found+= map.find(*key)!=map.end();
+    });
+    Bench::keep(found);
+    std::snprintf(name, sizeof(name), "%s, %s keys, %d%% misses", mapName, keyName, missPercent);
+    Bench::report(name, seconds, probes.size());
+  }
+}
+
+template <typename Key, typename Make>
+void compare(const char* keyName, std::size_t size, Make make)
+{
+  std::mt19937_64 random(3);
+  std::vector<Key> present;
+  std::vector<Key> absent;
+  for (std::size_t i=0;i<size;i++)
+  {
+    present.push_back(make(2*random()));
+    absent.push_back(make(2*random()+1));
+  }
+  char name[64];
+  std::snprintf(name, sizeof(name), "HashMap (%s)", PROBING);
+  lookups<Maps::HashMap<Key, std::size_t>>(name, keyName, present, absent);
+  lookups<std::unordered_map<Key, std::size_t>>("std::unordered_map", keyName, present, absent);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t size=Bench::sizeArgument(argc, argv, 1<<20);
+  compare<std::uint64_t>("uint64", size, [](std::uint64_t x) { return x; });
+  compare<std::string>("string", size, [](std::uint64_t x) { return "key:" + std::to_string(x); });
+  return 0;
+}
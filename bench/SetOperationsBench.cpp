@@ -0,0 +1,107 @@
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "TreeMap.h"
+#include "Bench.h"
+
+// TreeMap's join-based set operations against the find() loops they
+// replace, for a large map combined with maps from a thousandth of its size
+// to its full size. The set operations run with 1, 2, 4, ... threads, up to
+// the second argument, by default the number of hardware threads.
+
+namespace
+{
+
+using Key = std::uint64_t;
+using Map = Maps::TreeMap<Key, Key>;
+
+Map randomMap(std::size_t size, Key keys, unsigned seed)
+{
+  std::mt19937_64 random(seed);
+  Map map;
+  while (map.getSize()<size)
+    map[random()%keys]=map.getSize();
+  return map;
+}
+
+void uniteByFind(Map& map, const Map& other)
+{
+  for (auto it=other.begin();it!=other.end();++it)
+    if (map.find(it->first)==map.end())
+      map[it->first]=it->second;
+}
+
+void intersectByFind(Map& map, const Map& other)
+{
+  std::vector<Key> missing;
+  for (auto it=map.begin();it!=map.end();++it)
+    if (other.find(it->first)==other.end())
+      missing.push_back(it->first);
+  for (Key key : missing)
+    map.remove(key);
+}
+
+void subtractByFind(Map& map, const Map& other)
+{
+  for (auto it=other.begin();it!=other.end();++it)
+    if (map.find(it->first)!=map.end())
+      map.remove(it->first);
+}
+
+// Times operation on fresh copies of map and other, leaving copying out.
+template <typename Operation>
+void measure(const char* what, const Map& map, const Map& other, Operation operation)
+{
+  double best=0;
+  for (int run=0;run<3;run++)
+  {
+    Map mine(map);
+    Map theirs(other);
+    double elapsed=Bench::seconds([&] { operation(mine, theirs); });
+    Bench::keep(mine.getSize());
+    if (run==0 || elapsed<best)
+      best=elapsed;
+  }
+  Bench::reportTime(what, best);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t size=Bench::sizeArgument(argc, argv, 1<<20);
+  unsigned maxThreads=std::thread::hardware_concurrency();
+  if (argc>2)
+    maxThreads=static_cast<unsigned>(std::strtoul(argv[2], NULL, 10));
+  if (maxThreads==0)
+    maxThreads=1;
+  std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+  // Keys drawn from twice the size, so about half of them overlap.
+  Map map=randomMap(size, 2*size, 1);
+  char name[128];
+  for (std::size_t otherSize : {size/1000, size/10, size})
+  {
+    Map other=randomMap(otherSize, 2*size, 2);
+    auto measureThreads=[&](const char* what, void (Map::*operation)(Map&&, unsigned)) {
+      for (unsigned threads=1;threads<=maxThreads;threads*=2)
+      {
+        std::snprintf(name, sizeof(name), "%s, n=%zu, m=%zu, %u threads", what, size, otherSize, threads);
+        measure(name, map, other, [&](Map& mine, Map& theirs) { (mine.*operation)(std::move(theirs), threads); });
+      }
+    };
+    auto measureFind=[&](const char* what, void (*operation)(Map&, const Map&)) {
+      std::snprintf(name, sizeof(name), "%s, n=%zu, m=%zu", what, size, otherSize);
+      measure(name, map, other, [&](Map& mine, Map& theirs) { operation(mine, theirs); });
+    };
+    measureThreads("uniteWith", &Map::uniteWith);
+    measureFind("union by find()", uniteByFind);
+    measureThreads("intersectWith", &Map::intersectWith);
+    measureFind("intersection by find()", intersectByFind);
+    measureThreads("subtract", &Map::subtract);
+    measureFind("difference by find()", subtractByFind);
+  }
+  return 0;
+}
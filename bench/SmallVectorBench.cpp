@@ -0,0 +1,103 @@
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "SmallVector.h"
+#include "Vector.h"
+#include "Bench.h"
+
+// Heap allocations and time per short-lived vector of a few elements, for
+// SmallVector<Type, 8>, Vector and std::vector. Allocations are counted by
+// interposing malloc and realloc, which operator new also ends up in; that
+// needs glibc, elsewhere only times are reported.
+
+namespace
+{
+
+std::size_t allocations=0;
+
+}
+
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_realloc(void* pointer, std::size_t size);
+
+extern "C" void* malloc(std::size_t size)
+{
+  allocations++;
+  return __libc_malloc(size);
+}
+
+extern "C" void* realloc(void* pointer, std::size_t size)
+{
+  allocations++;
+  return __libc_realloc(pointer, size);
+}
+#endif
+
+namespace
+{
+
+template <typename Container>
+void append(Container& container, const typename Container::value_type& value)
+{
+  container.append(value);
+}
+
+template <typename Type>
+void append(std::vector<Type>& container, const Type& value)
+{
+  container.push_back(value);
+}
+
+template <typename Container, typename Make>
+void measure(const char* containerName, std::size_t length, Make make)
+{
+  const std::size_t ROUNDS=200000;
+  auto value=make();
+  std::size_t before=allocations;
+  double seconds=Bench::seconds([&] {
+    for (std::size_t round=0;round<ROUNDS;round++)
+    {
+      Container container;
+      for (std::size_t i=0;i<length;i++)
+        append(container, value);
+      Bench::keep(container);
+    }
+  });
+  char name[128];
+#if defined(__GLIBC__)
+  std::snprintf(name, sizeof(name), "%s, %zu elements, %.2f allocations", containerName, length,
+                static_cast<double>(allocations-before)/ROUNDS);
+#else
+  (void)before;
+  std::snprintf(name, sizeof(name), "%s, %zu elements", containerName, length);
+#endif
+  Bench::report(name, seconds, ROUNDS);
+}
+
+template <typename Type, typename Make>
+void compare(const char* typeName, Make make)
+{
+  char name[64];
+  for (std::size_t length : {0, 1, 4, 8, 9, 32})
+  {
+    std::snprintf(name, sizeof(name), "SmallVector<%s, 8>", typeName);
+    measure<Linear::SmallVector<Type, 8>>(name, length, make);
+    std::snprintf(name, sizeof(name), "Vector<%s>", typeName);
+    measure<Linear::Vector<Type>>(name, length, make);
+    std::snprintf(name, sizeof(name), "std::vector<%s>", typeName);
+    measure<std::vector<Type>>(name, length, make);
+  }
+}
+
+}
+
+int main()
+{
+  compare<int>("int", [] { return 7; });
+  // Short enough for the string's own inline buffer, so only the vectors allocate.
+  compare<std::string>("string", [] { return std::string("short"); });
+  return 0;
+}
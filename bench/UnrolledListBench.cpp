@@ -0,0 +1,65 @@
+#include <cstdint>
+#include <random>
+
+#include "LinkedList.h"
+#include "UnrolledList.h"
+#include "Vector.h"
+#include "Bench.h"
+
+// UnrolledList against LinkedList and Vector on full scans and on inserts
+// at random positions. Positions are reached with begin()+i, which walks
+// node by node in LinkedList, chunk by chunk in UnrolledList and is O(1) in
+// Vector. The lists built by random inserts are scanned again, since that
+// is where the nodes of a LinkedList end up scattered in memory.
+
+namespace
+{
+
+using Value = std::uint64_t;
+
+template <typename List>
+void scan(const char* listName, const char* what, const List& list)
+{
+  double seconds=Bench::bestOf(3, [&] {
+    Value sum=0;
+    for (auto it=list.begin();it!=list.end();++it)
+      sum+=*it;
+    Bench::keep(sum);
+  });
+  char name[128];
+  std::snprintf(name, sizeof(name), "%s, scan %s", listName, what);
+  Bench::report(name, seconds, list.getSize());
+}
+
+template <typename List>
+void measure(const char* listName, std::size_t size, std::size_t inserts)
+{
+  List appended;
+  for (std::size_t i=0;i<size;i++)
+    appended.append(i);
+  scan(listName, "after appends", appended);
+
+  List inserted;
+  std::mt19937_64 random(1);
+  double seconds=Bench::seconds([&] {
+    for (std::size_t i=0;i<inserts;i++)
+      inserted.insert(inserted.begin()+random()%(inserted.getSize()+1), i);
+  });
+  char name[128];
+  std::snprintf(name, sizeof(name), "%s, random inserts into 0..%zu", listName, inserts);
+  Bench::report(name, seconds, inserts);
+  scan(listName, "after random inserts", inserted);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t size=Bench::sizeArgument(argc, argv, 1<<22);
+  // Every insert walks to its position, so they get a smaller list.
+  std::size_t inserts=size/64;
+  measure<Linear::UnrolledList<Value>>("UnrolledList", size, inserts);
+  measure<Linear::LinkedList<Value>>("LinkedList", size, inserts);
+  measure<Linear::Vector<Value>>("Vector", size, inserts);
+  return 0;
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "Algorithms.h"
+#include "SmallVector.h"
+#include "Vector.h"
+#include "Check.h"
+
+using namespace Linear;
+
+namespace
+{
+
+// Long enough to be split between threads.
+constexpr std::size_t SIZE = 100000;
+
+template <typename Container, typename Policy>
+void checkWithPolicy(Policy& policy, const std::vector<std::int64_t>& expected)
+{
+  Container container(expected.begin(), expected.end());
+  std::vector<std::int64_t> reference(expected);
+
+  CHECK(Algorithms::reduce(policy, container, std::int64_t(0)) ==
+        std::accumulate(reference.begin(), reference.end(), std::int64_t(0)));
+  CHECK(Algorithms::reduce(policy, container, std::int64_t(1), [](std::int64_t a, std::int64_t b) { return a^b; }) ==
+        std::accumulate(reference.begin(), reference.end(), std::int64_t(1), std::bit_xor<std::int64_t>()));
+
+  std::int64_t needle=reference[reference.size()*3/4];
+  CHECK(Algorithms::find(policy, container, needle)-container.begin() ==
+        std::find(reference.begin(), reference.end(), needle)-reference.begin());
+  CHECK(Algorithms::find(policy, container, std::int64_t(-1))==container.end());
+  auto isOdd=[](std::int64_t x) { return x%2!=0; };
+  CHECK(Algorithms::find_if(policy, container, isOdd)-container.begin() ==
+        std::find_if(reference.begin(), reference.end(), isOdd)-reference.begin());
+
+  auto twice=[](std::int64_t x) { return 2*x; };
+  Algorithms::transform(policy, container, twice);
+  std::transform(reference.begin(), reference.end(), reference.begin(), twice);
+  CHECK(std::equal(container.begin(), container.end(), reference.begin(), reference.end()));
+
+  Container output(expected.begin(), expected.end());
+  Algorithms::transform(policy, container, output, [](std::int64_t x) { return x+1; });
+  for (std::size_t i=0;i<reference.size();i++)
+    CHECK(output[i]==reference[i]+1);
+
+  Algorithms::sort(policy, container);
+  std::sort(reference.begin(), reference.end());
+  CHECK(std::equal(container.begin(), container.end(), reference.begin(), reference.end()));
+  Algorithms::sort(policy, container, std::greater<std::int64_t>());
+  std::sort(reference.begin(), reference.end(), std::greater<std::int64_t>());
+  CHECK(std::equal(container.begin(), container.end(), reference.begin(), reference.end()));
+
+  Algorithms::fill(policy, container, std::int64_t(7));
+  CHECK(std::all_of(container.begin(), container.end(), [](std::int64_t x) { return x==7; }));
+}
+
+template <typename Container>
+void checkSerial(const std::vector<std::int64_t>& expected)
+{
+  Container container(expected.begin(), expected.end());
+  std::vector<std::int64_t> reference(expected);
+
+  CHECK(Algorithms::reduce(container, std::int64_t(0)) ==
+        std::accumulate(reference.begin(), reference.end(), std::int64_t(0)));
+  std::int64_t needle=reference[reference.size()/2];
+  CHECK(Algorithms::find(container, needle)-container.begin() ==
+        std::find(reference.begin(), reference.end(), needle)-reference.begin());
+  Algorithms::sort(container);
+  std::sort(reference.begin(), reference.end());
+  CHECK(std::equal(container.begin(), container.end(), reference.begin(), reference.end()));
+}
+
+void checkDoubleSum(std::mt19937_64& random)
+{
+  std::uniform_int_distribution<int> values(-1000, 1000);
+  Vector<double> container;
+  double expected=0;
+  for (std::size_t i=0;i<SIZE;i++)
+  {
+    double value=values(random)/4.0;//exact in double, so the order of additions does not matter
+    container.append(value);
+    expected+=value;
+  }
+  Algorithms::Parallel policy(4);
+  CHECK(Algorithms::reduce(container, 0.0)==expected);
+  CHECK(Algorithms::reduce(policy, container, 0.0)==expected);
+}
+
+// Like std::find, find compares the value as it is given, without first
+// converting it to the element type.
+void checkMixedTypes()
+{
+  Vector<std::int32_t> container;
+  std::vector<std::int32_t> reference;
+  for (std::int32_t i=0;i<static_cast<std::int32_t>(SIZE);i++)
+  {
+    container.append(i%10);
+    reference.push_back(i%10);
+  }
+  Algorithms::Parallel policy(4);
+  for (double needle : {3.5, 3.0, -0.5, 9.0})
+  {
+    std::size_t expected=std::find(reference.begin(), reference.end(), needle)-reference.begin();
+    CHECK(static_cast<std::size_t>(Algorithms::find(container, needle)-container.begin())==expected);
+    CHECK(static_cast<std::size_t>(Algorithms::find(policy, container, needle)-container.begin())==expected);
+  }
+  std::int64_t wide=std::int64_t(1)<<32;//3 when truncated to 32 bits
+  CHECK(Algorithms::find(container, wide+3)==container.end());
+  CHECK(Algorithms::find(policy, container, wide+3)==container.end());
+  CHECK(Algorithms::find(container, std::int64_t(3))==container.begin()+3);
+}
+
+}
+
+int main()
+{
+  std::mt19937_64 random(2024);
+  std::uniform_int_distribution<std::int64_t> values(0, SIZE);
+  std::vector<std::int64_t> expected(SIZE);
+  for (std::int64_t& value : expected)
+    value=values(random);
+
+  // Every parallel overload must be picked for non-const lvalue, const
+  // lvalue and temporary policies alike.
+  Algorithms::Parallel policy(4);
+  const Algorithms::Parallel constPolicy(4);
+  checkWithPolicy<Vector<std::int64_t>>(policy, expected);
+  checkWithPolicy<Vector<std::int64_t>>(constPolicy, expected);
+  checkWithPolicy<SmallVector<std::int64_t, 16>>(policy, expected);
+  checkWithPolicy<Vector<std::int64_t>, const Algorithms::Parallel>(Algorithms::Parallel(3), expected);
+
+  checkSerial<Vector<std::int64_t>>(expected);
+  checkSerial<SmallVector<std::int64_t, 16>>(expected);
+  checkDoubleSum(random);
+  checkMixedTypes();
+  return 0;
+}
@@ -0,0 +1,214 @@
+#include <cstddef>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "BTreeMap.h"
+#include "Check.h"
+
+namespace
+{
+
+template <typename Map, typename Reference>
+void checkEqual(const Map& map, const Reference& reference)
+{
+  CHECK(map.getSize()==reference.size());
+  CHECK(map.isEmpty()==reference.empty());
+  auto it=map.begin();
+  for (const auto& entry : reference)
+  {
+    CHECK(it!=map.end());
+    CHECK((*it).first==entry.first && (*it).second==entry.second);
+    ++it;
+  }
+  CHECK(it==map.end());
+  for (auto entry=reference.rbegin();entry!=reference.rend();++entry)
+  {
+    --it;
+    CHECK((*it).first==entry->first);
+  }
+  CHECK(it==map.begin());
+}
+
+// Applies the same random operations to a BTreeMap and a std::map.
+template <typename Key, typename MakeKey>
+void differential(unsigned seed, int keys, MakeKey makeKey)
+{
+  std::mt19937 random(seed);
+  Maps::BTreeMap<Key, int> map;
+  std::map<Key, int> reference;
+  for (int step=0;step<40000;step++)
+  {
+    // Grows towards keys distinct keys, then shrinks again, so nodes are
+    // split as well as merged and borrowed from.
+    bool growing=step/8000%2==0;
+    Key key=makeKey(static_cast<int>(random()%keys));
+    int value=static_cast<int>(random()%1000);
+    unsigned operation=random()%100;
+    if (operation<(growing ? 40u : 15u))
+    {
+      map[key]=value;
+      reference[key]=value;
+    }
+    else if (operation<(growing ? 50u : 25u))
+    {
+      bool inserted=map.try_emplace(key, value).second;
+      CHECK(inserted==reference.emplace(key, value).second);
+    }
+    else if (operation<(growing ? 60u : 35u))
+    {
+      bool inserted=map.insert_or_assign(key, value).second;
+      CHECK(inserted==(reference.count(key)==0));
+      reference[key]=value;
+    }
+    else if (operation<(growing ? 65u : 40u))
+    {
+      auto result=map.emplace(key, value);
+      CHECK(result.second==reference.emplace(key, value).second);
+      CHECK((*result.first).first==key);
+    }
+    else if (operation<85)
+    {
+      bool present=reference.erase(key)!=0;
+      bool thrown=false;
+      try
+      {
+        map.remove(key);
+      }
+      catch (std::out_of_range&)
+      {
+        thrown=true;
+      }
+      CHECK(thrown!=present);
+    }
+    else if (operation<90)
+    {
+      auto it=map.find(key);
+      CHECK((it==map.end())==(reference.count(key)==0));
+      if (it!=map.end())
+      {
+        map.remove(it);
+        reference.erase(key);
+      }
+    }
+    else if (operation<97)
+    {
+      auto expected=reference.find(key);
+      bool thrown=false;
+      try
+      {
+        int found=map.valueOf(key);
+        CHECK(expected!=reference.end() && found==expected->second);
+      }
+      catch (std::out_of_range&)
+      {
+        thrown=true;
+      }
+      CHECK(thrown==(expected==reference.end()));
+    }
+    else if (operation<99)
+    {
+      Maps::BTreeMap<Key, int> copy(map);
+      CHECK(copy==map);
+      map=std::move(copy);
+    }
+    else if (random()%10==0)
+    {
+      map.erase();
+      reference.clear();
+    }
+    if (step%997==0)
+      checkEqual(map, reference);
+  }
+  checkEqual(map, reference);
+}
+
+// A mapped type without a default constructor that counts live objects,
+// so that a value constructed or destroyed too often shows up.
+struct Counted
+{
+  static const unsigned ALIVE = 0x600dcafe;
+  static long live;
+  unsigned state;
+  int value;
+
+  explicit Counted(int value) : state(ALIVE), value(value)
+  {
+    live++;
+  }
+
+  Counted(const Counted& other) : state(ALIVE), value(other.value)
+  {
+    live++;
+  }
+
+  Counted& operator=(const Counted&) = default;
+
+  ~Counted()
+  {
+    CHECK(state==ALIVE);
+    state=0;
+    live--;
+  }
+};
+
+long Counted::live=0;
+
+// Fills and empties a map in random order, so that values are moved by
+// splits, borrows and merges, and checks that exactly the values in the map
+// are alive.
+void lifetimes(unsigned seed)
+{
+  using Map = Maps::BTreeMap<int, Counted>;
+  std::mt19937 random(seed);
+  {
+    Map map;
+    std::map<int, int> reference;
+    for (int step=0;step<30000;step++)
+    {
+      int key=static_cast<int>(random()%3000);
+      bool growing=step/5000%2==0;
+      if (random()%10<(growing ? 7u : 3u))
+      {
+        map.try_emplace(key, key);
+        reference.emplace(key, key);
+      }
+      else if (reference.erase(key)!=0)
+        map.remove(key);
+      CHECK(Counted::live==static_cast<long>(reference.size()));
+    }
+    auto it=map.begin();
+    for (const auto& entry : reference)
+    {
+      CHECK(it->first==entry.first && it->second.value==entry.second);
+      // The key is read-only through iterators, the value is not.
+      static_assert(std::is_const<std::remove_reference_t<decltype(it->first)>>::value, "");
+      it->second.value=-entry.second;
+      ++it;
+    }
+    CHECK(it==map.end());
+    Map copy(map);
+    CHECK(Counted::live==2*static_cast<long>(reference.size()));
+    for (const auto& entry : reference)
+      CHECK(copy.valueOf(entry.first).value==-entry.second);
+    map.erase();
+    CHECK(Counted::live==static_cast<long>(reference.size()));
+  }
+  CHECK(Counted::live==0);
+}
+
+}
+
+int main()
+{
+  auto number=[](int x) { return x; };
+  auto text=[](int x) { return "key:" + std::to_string(x); };
+  differential<int>(1, 5000, number);
+  differential<long long>(2, 300, [](int x) { return static_cast<long long>(x)*x; });
+  differential<std::string>(3, 3000, text);
+  lifetimes(4);
+  return 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Like assert, but also checked when NDEBUG is defined.
+#define CHECK(condition) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      std::exit(EXIT_FAILURE); \
+    } \
+  } while (false)
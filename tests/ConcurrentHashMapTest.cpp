@@ -0,0 +1,185 @@
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ConcurrentHashMap.h"
+#include "Check.h"
+
+namespace
+{
+
+template <typename Map, typename Reference>
+void checkEqual(const Map& map, const Reference& reference)
+{
+  CHECK(map.getSize()==reference.size());
+  CHECK(map.isEmpty()==reference.empty());
+  std::size_t visited=0;
+  map.forEach([&](const typename Map::value_type& entry) {
+    auto expected=reference.find(entry.first);
+    CHECK(expected!=reference.end());
+    CHECK(expected->second==entry.second);
+    visited++;
+  });
+  CHECK(visited==reference.size());
+}
+
+// Applies the same random operations to a ConcurrentHashMap and a
+// std::unordered_map from one thread.
+template <std::size_t ShardCount>
+void differential(unsigned seed)
+{
+  std::mt19937 random(seed);
+  Maps::ConcurrentHashMap<std::string, int, std::hash<std::string>, std::equal_to<std::string>, ShardCount> map;
+  std::unordered_map<std::string, int> reference;
+  for (int step=0;step<20000;step++)
+  {
+    std::string key="key:" + std::to_string(random()%500);
+    int value=static_cast<int>(random()%1000);
+    switch (random()%7)
+    {
+    case 0:
+      CHECK(map.try_emplace(key, value)==reference.emplace(key, value).second);
+      break;
+    case 1:
+      CHECK(map.insert_or_assign(key, value)==(reference.count(key)==0));
+      reference[key]=value;
+      break;
+    case 2:
+      map.update(key, [value](int& current) { current+=value; });
+      reference[key]+=value;
+      break;
+    case 3:
+    {
+      bool present=reference.erase(key)!=0;
+      bool thrown=false;
+      try
+      {
+        map.remove(key);
+      }
+      catch (std::out_of_range&)
+      {
+        thrown=true;
+      }
+      CHECK(thrown!=present);
+      break;
+    }
+    case 4:
+    {
+      auto expected=reference.find(key);
+      CHECK(map.contains(key)==(expected!=reference.end()));
+      bool thrown=false;
+      try
+      {
+        int value=map.valueOf(key);
+        CHECK(expected!=reference.end() && value==expected->second);
+      }
+      catch (std::out_of_range&)
+      {
+        thrown=true;
+      }
+      CHECK(thrown==(expected==reference.end()));
+      break;
+    }
+    case 5:
+    {
+      int seen=-1;
+      bool found=map.visit(key, [&seen](const int& current) { seen=current; });
+      CHECK(found==(reference.count(key)!=0));
+      if (found)
+        CHECK(seen==reference[key]);
+      break;
+    }
+    default:
+      if (random()%200==0)
+      {
+        map.erase();
+        reference.clear();
+      }
+    }
+    if (step%997==0)
+      checkEqual(map, reference);
+  }
+  checkEqual(map, reference);
+}
+
+// Writers own disjoint keys and mirror their own operations, while readers
+// look up any key; at the end the map must equal the writers' mirrors.
+void concurrentWriters()
+{
+  const unsigned WRITERS=4;
+  const unsigned READERS=4;
+  const int KEYS=4000;
+  Maps::ConcurrentHashMap<int, int> map;
+  std::vector<std::unordered_map<int, int>> mirrors(WRITERS);
+  std::vector<std::thread> threads;
+  for (unsigned writer=0;writer<WRITERS;writer++)
+    threads.emplace_back([&, writer] {
+      std::mt19937 random(writer);
+      std::unordered_map<int, int>& mirror=mirrors[writer];
+      for (int step=0;step<50000;step++)
+      {
+        int key=static_cast<int>(random()%(KEYS/WRITERS)*WRITERS+writer);
+        if (random()%3!=0)
+        {
+          map.insert_or_assign(key, step);
+          mirror[key]=step;
+        }
+        else if (mirror.erase(key)!=0)
+          map.remove(key);
+      }
+    });
+  for (unsigned reader=0;reader<READERS;reader++)
+    threads.emplace_back([&, reader] {
+      std::mt19937 random(100+reader);
+      for (int step=0;step<50000;step++)
+      {
+        int key=static_cast<int>(random()%KEYS);
+        map.visit(key, [](const int& value) { CHECK(value>=0 && value<50000); });
+        map.contains(key);
+        CHECK(map.getSize()<=static_cast<std::size_t>(KEYS));
+      }
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+
+  std::unordered_map<int, int> reference;
+  for (const auto& mirror : mirrors)
+    reference.insert(mirror.begin(), mirror.end());
+  checkEqual(map, reference);
+}
+
+// update() is atomic per key, so no increment may be lost.
+void concurrentUpdates()
+{
+  const unsigned THREADS=8;
+  const int KEYS=100;
+  const int ROUNDS=500;
+  Maps::ConcurrentHashMap<int, int> map;
+  std::vector<std::thread> threads;
+  for (unsigned thread=0;thread<THREADS;thread++)
+    threads.emplace_back([&map] {
+      for (int round=0;round<ROUNDS;round++)
+        for (int key=0;key<KEYS;key++)
+          map.update(key, [](int& value) { value++; });
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+  CHECK(map.getSize()==static_cast<std::size_t>(KEYS));
+  for (int key=0;key<KEYS;key++)
+    CHECK(map.valueOf(key)==static_cast<int>(THREADS)*ROUNDS);
+}
+
+}
+
+int main()
+{
+  differential<64>(1);
+  differential<1>(2);
+  concurrentWriters();
+  concurrentUpdates();
+  return 0;
+}
@@ -0,0 +1,191 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentQueue.h"
+#include "ConcurrentStack.h"
+#include "Check.h"
+
+using namespace Linear;
+
+namespace
+{
+
+// Applies the same random operations to a ConcurrentQueue and a
+// ConcurrentStack, from one thread, and to std::deques used as a queue and
+// as a stack.
+void differential(unsigned seed)
+{
+  std::mt19937 random(seed);
+  ConcurrentQueue<std::string> queue;
+  ConcurrentStack<std::string> stack;
+  std::deque<std::string> queueReference, stackReference;
+  for (int step=0;step<20000;step++)
+  {
+    // Some strings longer than the inline buffer of std::string.
+    std::string value(random()%3==0 ? 40 : 3, static_cast<char>('a'+random()%26));
+    switch (random()%5)
+    {
+    case 0:
+    case 1:
+      queue.append(value);
+      queueReference.push_back(value);
+      stack.append(value);
+      stackReference.push_back(value);
+      break;
+    case 2:
+    {
+      bool queueEmpty=queueReference.empty();
+      bool stackEmpty=stackReference.empty();
+      bool thrown=false;
+      try
+      {
+        std::string first=queue.popFirst();
+        CHECK(!queueEmpty && first==queueReference.front());
+        queueReference.pop_front();
+      }
+      catch (std::out_of_range&)
+      {
+        thrown=true;
+      }
+      CHECK(thrown==queueEmpty);
+      thrown=false;
+      try
+      {
+        std::string last=stack.popLast();
+        CHECK(!stackEmpty && last==stackReference.back());
+        stackReference.pop_back();
+      }
+      catch (std::out_of_range&)
+      {
+        thrown=true;
+      }
+      CHECK(thrown==stackEmpty);
+      break;
+    }
+    case 3:
+    {
+      std::string item;
+      if (queue.tryPopFirst(item))
+      {
+        CHECK(!queueReference.empty());
+        CHECK(item==queueReference.front());
+        queueReference.pop_front();
+      }
+      else
+        CHECK(queueReference.empty());
+      if (stack.tryPopLast(item))
+      {
+        CHECK(!stackReference.empty());
+        CHECK(item==stackReference.back());
+        stackReference.pop_back();
+      }
+      else
+        CHECK(stackReference.empty());
+      break;
+    }
+    default:
+      CHECK(queue.isEmpty()==queueReference.empty());
+      CHECK(stack.isEmpty()==stackReference.empty());
+    }
+  }
+  // Whatever is left is destroyed with the containers.
+}
+
+// Items carry their producer and sequence number.
+const unsigned PRODUCERS=4;
+const unsigned CONSUMERS=4;
+const std::uint64_t ITEMS=50000;
+
+std::uint64_t item(unsigned producer, std::uint64_t sequence)
+{
+  return static_cast<std::uint64_t>(producer)*ITEMS+sequence;
+}
+
+// Producers and consumers run at once. Every item must be popped exactly
+// once and, the queue being FIFO, each consumer must see the items of any
+// one producer in the order they were appended.
+void concurrentQueue()
+{
+  ConcurrentQueue<std::uint64_t> queue;
+  std::vector<std::atomic<int>> popped(PRODUCERS*ITEMS);
+  for (std::atomic<int>& count : popped)
+    count.store(0);
+  std::atomic<std::uint64_t> remaining(PRODUCERS*ITEMS);
+  std::vector<std::thread> threads;
+  for (unsigned producer=0;producer<PRODUCERS;producer++)
+    threads.emplace_back([&queue, producer] {
+      for (std::uint64_t sequence=0;sequence<ITEMS;sequence++)
+        queue.append(item(producer, sequence));
+    });
+  for (unsigned consumer=0;consumer<CONSUMERS;consumer++)
+    threads.emplace_back([&] {
+      std::vector<std::uint64_t> next(PRODUCERS, 0);
+      std::uint64_t value;
+      while (remaining.load()>0)
+      {
+        if (!queue.tryPopFirst(value))
+        {
+          std::this_thread::yield();
+          continue;
+        }
+        remaining--;
+        CHECK(value<PRODUCERS*ITEMS);
+        popped[value]++;
+        unsigned producer=static_cast<unsigned>(value/ITEMS);
+        CHECK(value%ITEMS>=next[producer]);
+        next[producer]=value%ITEMS+1;
+      }
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+  CHECK(queue.isEmpty());
+  for (std::atomic<int>& count : popped)
+    CHECK(count.load()==1);
+}
+
+// Threads both push and pop; together with what is left at the end, every
+// item must be popped exactly once.
+void concurrentStack()
+{
+  const unsigned THREADS=8;
+  ConcurrentStack<std::uint64_t> stack;
+  std::vector<std::atomic<int>> popped(THREADS*ITEMS);
+  for (std::atomic<int>& count : popped)
+    count.store(0);
+  std::vector<std::thread> threads;
+  for (unsigned thread=0;thread<THREADS;thread++)
+    threads.emplace_back([&, thread] {
+      std::uint64_t value;
+      for (std::uint64_t sequence=0;sequence<ITEMS;sequence++)
+      {
+        stack.append(item(thread, sequence));
+        if (sequence%2==1 && stack.tryPopLast(value))
+          popped[value]++;
+      }
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+  std::uint64_t value;
+  while (stack.tryPopLast(value))
+    popped[value]++;
+  for (std::atomic<int>& count : popped)
+    CHECK(count.load()==1);
+}
+
+}
+
+int main()
+{
+  differential(1);
+  differential(2);
+  concurrentQueue();
+  concurrentStack();
+  return 0;
+}
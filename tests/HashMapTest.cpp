@@ -0,0 +1,500 @@
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "HashMap.h"
+#include "Check.h"
+
+// Also built with MAPS_HASHMAP_SCALAR_PROBING, as HashMapScalarTest.
+
+namespace
+{
+
+// Sends every key to one of a few probe sequences, so groups fill up and
+// lookups have to skip many fingerprint matches.
+struct CollidingHash
+{
+  std::size_t operator()(int key) const
+  {
+    return static_cast<std::size_t>(key%5);
+  }
+};
+
+template <typename Map, typename Reference>
+void checkEqual(const Map& map, const Reference& reference)
+{
+  CHECK(map.getSize()==reference.size());
+  CHECK(map.isEmpty()==reference.empty());
+  std::size_t visited=0;
+  for (auto it=map.begin();it!=map.end();++it)
+  {
+    auto expected=reference.find((*it).first);
+    CHECK(expected!=reference.end());
+    CHECK(expected->second==(*it).second);
+    visited++;
+  }
+  CHECK(visited==reference.size());
+  for (const auto& entry : reference)
+    CHECK(map.valueOf(entry.first)==entry.second);
+}
+
+// Applies the same random operations to a HashMap and a std::unordered_map.
+template <typename Hash, typename Key, typename MakeKey>
+void differential(unsigned seed, int keys, MakeKey makeKey)
+{
+  std::mt19937 random(seed);
+  Maps::HashMap<Key, int, Hash> map;
+  std::unordered_map<Key, int, Hash> reference;
+  for (int step=0;step<30000;step++)
+  {
+    // Grows towards keys distinct keys, then shrinks again.
+    bool growing=step/5000%2==0;
+    Key key=makeKey(static_cast<int>(random()%keys));
+    int value=static_cast<int>(random()%1000);
+    unsigned operation=random()%100;
+    if (operation<(growing ? 40u : 15u))
+    {
+      map[key]=value;
+      reference[key]=value;
+    }
+    else if (operation<(growing ? 55u : 30u))
+    {
+      bool inserted=map.try_emplace(key, value).second;
+      CHECK(inserted==reference.emplace(key, value).second);
+    }
+    else if (operation<(growing ? 65u : 40u))
+    {
+      bool inserted=map.insert_or_assign(key, value).second;
+      CHECK(inserted==(reference.count(key)==0));
+      reference[key]=value;
+    }
+    else if (operation<80)
+    {
+      bool present=reference.erase(key)!=0;
+      bool thrown=false;
+      try
+      {
+        map.remove(key);
+      }
+      catch (std::out_of_range&)
+      {
+        thrown=true;
+      }
+      CHECK(thrown!=present);
+    }
+    else if (operation<85)
+    {
+      auto it=map.find(key);
+      if (it!=map.end())
+      {
+        map.remove(it);
+        reference.erase(key);
+      }
+    }
+    else if (operation<95)
+    {
+      auto it=map.find(key);
+      auto expected=reference.find(key);
+      CHECK((it==map.end())==(expected==reference.end()));
+      if (expected!=reference.end())
+        CHECK((*it).second==expected->second);
+    }
+    else if (operation<97)
+    {
+      Maps::HashMap<Key, int, Hash> copy(map);
+      CHECK(copy==map);
+      map=std::move(copy);
+    }
+    else if (operation<99)
+    {
+      if (random()%2==0)
+        map.reserve(reference.size()+random()%100);
+      else
+        map.rehash(random()%256);
+    }
+    else if (random()%10==0)
+    {
+      map.erase();
+      reference.clear();
+    }
+    if (step%499==0)
+      checkEqual(map, reference);
+  }
+  checkEqual(map, reference);
+}
+
+// Entries are kept dense: new keys go at the end and a removed key's place
+// is taken by the last one. order models that, and iteration, forwards and
+// backwards, must follow it through rehashes, copies and moves.
+void insertionOrder(unsigned seed)
+{
+  std::mt19937 random(seed);
+  Maps::HashMap<int, int> map;
+  std::vector<int> order;
+  auto removeFromOrder=[&order](int key) {
+    auto position=std::find(order.begin(), order.end(), key);
+    *position=order.back();
+    order.pop_back();
+  };
+  for (int step=0;step<20000;step++)
+  {
+    int key=static_cast<int>(random()%500);
+    bool present=std::find(order.begin(), order.end(), key)!=order.end();
+    switch (random()%6)
+    {
+    case 0:
+    case 1:
+      map[key]=key;
+      if (!present)
+        order.push_back(key);
+      break;
+    case 2:
+      if (present)
+      {
+        map.remove(key);
+        removeFromOrder(key);
+      }
+      break;
+    case 3:
+      if (present)
+      {
+        map.remove(map.find(key));
+        removeFromOrder(key);
+      }
+      break;
+    case 4:
+      if (random()%2==0)
+        map.rehash(random()%2048);
+      else
+        map.shrink_to_fit();
+      break;
+    default:
+      if (random()%2==0)
+      {
+        Maps::HashMap<int, int> copy(map);
+        map=std::move(copy);
+      }
+      else
+        map=Maps::HashMap<int, int>(map);
+    }
+    if (step%97==0)
+    {
+      auto it=map.cbegin();
+      for (int expected : order)
+      {
+        CHECK(it!=map.cend() && it->first==expected);
+        ++it;
+      }
+      CHECK(it==map.cend());
+      for (auto expected=order.rbegin();expected!=order.rend();++expected)
+      {
+        --it;
+        CHECK(it->first==*expected);
+      }
+      CHECK(it==map.cbegin());
+    }
+  }
+
+  // Iterating a large, emptied table visits nothing.
+  map.reserve(100000);
+  map.erase();
+  CHECK(map.bucket_count()>=100000 && map.begin()==map.end());
+}
+
+// A key that counts its constructions, so that a lookup which builds a
+// temporary key shows up.
+struct Name
+{
+  static long made;
+  std::string text;
+
+  explicit Name(std::string_view text) : text(text)
+  {
+    made++;
+  }
+
+  Name(const Name& other) : text(other.text)
+  {
+    made++;
+  }
+
+  Name(Name&& other) noexcept : text(std::move(other.text))
+  {
+    made++;
+  }
+};
+
+long Name::made=0;
+
+struct NameHash
+{
+  using is_transparent = void;
+
+  std::size_t operator()(std::string_view text) const
+  {
+    return std::hash<std::string_view>()(text);
+  }
+
+  std::size_t operator()(const Name& name) const
+  {
+    return (*this)(std::string_view(name.text));
+  }
+};
+
+struct NameEqual
+{
+  using is_transparent = void;
+
+  static std::string_view view(const Name& name)
+  {
+    return name.text;
+  }
+
+  static std::string_view view(std::string_view text)
+  {
+    return text;
+  }
+
+  template <typename A, typename B>
+  bool operator()(const A& a, const B& b) const
+  {
+    return view(a)==view(b);
+  }
+};
+
+// Counts the calls made to it through the instance given to the map.
+struct CountingHash
+{
+  long* calls;
+
+  CountingHash() : calls(NULL)
+  {}
+
+  explicit CountingHash(long* calls) : calls(calls)
+  {}
+
+  std::size_t operator()(int key) const
+  {
+    if (calls!=NULL)
+      (*calls)++;
+    return std::hash<int>()(key);
+  }
+};
+
+// Only the lower case of a key counts, in hashing and in comparing.
+std::string folded(std::string key)
+{
+  for (char& c : key)
+    c=static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  return key;
+}
+
+struct FoldedHash
+{
+  std::size_t operator()(const std::string& key) const
+  {
+    return std::hash<std::string>()(folded(key));
+  }
+};
+
+struct FoldedEqual
+{
+  bool operator()(const std::string& a, const std::string& b) const
+  {
+    return folded(a)==folded(b);
+  }
+};
+
+void pluggableHash()
+{
+  // Transparent lookups find, read and remove without building a Name.
+  Maps::HashMap<Name, int, NameHash, NameEqual> names;
+  for (int i=0;i<1000;i++)
+    names.try_emplace(Name("name" + std::to_string(i)), i);
+  long made=Name::made;
+  for (int i=0;i<1000;i++)
+  {
+    std::string text="name" + std::to_string(i);
+    std::string_view view(text);
+    CHECK(names.find(view)!=names.end() && names.find(view)->second==i);
+    CHECK(names.valueOf(view)==i);
+    names.valueOf(view)++;
+  }
+  CHECK(names.find(std::string_view("missing"))==names.end());
+  const auto& constNames=names;
+  CHECK(constNames.find(std::string_view("name5"))->second==6);
+  CHECK(constNames.valueOf(std::string_view("name7"))==8);
+  CHECK(Name::made==made);
+  for (int i=0;i<1000;i+=2)
+    names.remove(std::string_view("name" + std::to_string(i)));
+  CHECK(names.getSize()==500 && names.find(std::string_view("name2"))==names.end());
+
+  // The hasher the map was constructed with is the one it calls.
+  long calls=0;
+  Maps::HashMap<int, int, CountingHash> counted((CountingHash(&calls)));
+  for (int key=0;key<100;key++)
+    counted[key]=key;
+  CHECK(calls>=100);
+  long before=calls;
+  CHECK(counted.find(42)->second==42 && calls==before+1);
+  Maps::HashMap<int, int, CountingHash> copy(counted);
+  before=calls;
+  CHECK(copy.find(1)->second==1 && calls==before+1);
+
+  // Keys equal under KeyEqual are one key.
+  Maps::HashMap<std::string, int, FoldedHash, FoldedEqual> caseless;
+  std::unordered_map<std::string, int, FoldedHash, FoldedEqual> reference;
+  std::mt19937 random(5);
+  for (int step=0;step<5000;step++)
+  {
+    std::string key="Key";
+    key+=std::to_string(random()%50);
+    for (char& c : key)
+      c=static_cast<char>(random()%2==0 ? std::toupper(c) : std::tolower(c));
+    int value=static_cast<int>(random()%1000);
+    if (random()%4==0)
+    {
+      bool present=reference.erase(key)!=0;
+      CHECK((caseless.find(key)!=caseless.end())==present);
+      if (present)
+        caseless.remove(key);
+    }
+    else
+    {
+      caseless.insert_or_assign(key, value);
+      reference[key]=value;
+    }
+  }
+  checkEqual(caseless, reference);
+}
+
+bool isPowerOfTwo(std::size_t x)
+{
+  return x!=0 && (x&(x-1))==0;
+}
+
+// The table starts empty and doubles as keys arrive; tombstones left by
+// removals are cleared by rehashing, so a steady churn does not grow it.
+void growth()
+{
+  Maps::HashMap<int, int> map;
+  CHECK(map.bucket_count()==0 && map.begin()==map.end());
+  CHECK(map.find(7)==map.end());
+  const int KEYS=50000;
+  std::size_t buckets=0;
+  for (int key=0;key<KEYS;key++)
+  {
+    map[key]=-key;
+    CHECK(isPowerOfTwo(map.bucket_count()) && map.bucket_count()>=buckets);
+    CHECK(map.getSize()<=map.bucket_count()-map.bucket_count()/8);
+    buckets=map.bucket_count();
+    if (key%4999==0)
+      for (int present=0;present<=key;present++)
+        CHECK(map.valueOf(present)==-present);
+  }
+
+  Maps::HashMap<int, int> churned;
+  for (int key=0;key<200;key++)
+    churned[key]=key;
+  for (int key=200;key<100000;key++)
+  {
+    churned.remove(key-200);
+    churned[key]=key;
+    CHECK(churned.getSize()==200 && churned.bucket_count()<=1024);
+  }
+  for (int key=100000-200;key<100000;key++)
+    CHECK(churned.valueOf(key)==key);
+}
+
+// reserve(n) makes room for n entries at once, rehash() and shrink_to_fit()
+// never go below what the entries need, and the load factor stays under
+// max_load_factor() as the map grows.
+void capacity()
+{
+  Maps::HashMap<int, int> map;
+  map.reserve(1000);
+  std::size_t reserved=map.bucket_count();
+  CHECK(isPowerOfTwo(reserved) && map.getSize()==0);
+  for (int key=0;key<1000;key++)
+    map[key]=key;
+  CHECK(map.bucket_count()==reserved);
+  map.reserve(10);
+  CHECK(map.bucket_count()==reserved);
+
+  map.rehash(4*reserved+1);
+  CHECK(map.bucket_count()==8*reserved);
+  for (int key=0;key<900;key++)
+    map.remove(key);
+  map.shrink_to_fit();
+  CHECK(isPowerOfTwo(map.bucket_count()) && map.bucket_count()<=256);
+  map.rehash(1);
+  std::size_t smallest=map.bucket_count();
+  CHECK(map.load_factor()==static_cast<float>(100)/smallest && map.load_factor()<=0.875f);
+  for (int key=900;key<1000;key++)
+    CHECK(map.valueOf(key)==key);
+
+  Maps::HashMap<int, int> empty;
+  empty.rehash(0);
+  CHECK(empty.bucket_count()==0 && empty.load_factor()==0);
+  empty.rehash(3);
+  CHECK(empty.bucket_count()>=3 && isPowerOfTwo(empty.bucket_count()));
+  empty.shrink_to_fit();
+  CHECK(empty.bucket_count()==0);
+
+  Maps::HashMap<int, int> sparse(100);
+  CHECK(sparse.bucket_count()>=100);
+  sparse.max_load_factor(0.25f);
+  CHECK(sparse.max_load_factor()==0.25f);
+  for (int key=0;key<5000;key++)
+  {
+    sparse[key]=key;
+    CHECK(sparse.load_factor()<=0.25f);
+  }
+  // Lowering the factor rehashes at once; raising it waits for a rehash.
+  sparse.max_load_factor(0.125f);
+  CHECK(sparse.load_factor()<=0.125f);
+  std::size_t buckets=sparse.bucket_count();
+  sparse.max_load_factor(2.0f);
+  CHECK(sparse.bucket_count()==buckets);
+  sparse.shrink_to_fit();
+  CHECK(sparse.bucket_count()<buckets && sparse.load_factor()<=0.875f);
+  for (int key=0;key<5000;key++)
+    CHECK(sparse.valueOf(key)==key);
+
+  for (float factor : {0.0f, -1.0f})
+  {
+    bool thrown=false;
+    try
+    {
+      sparse.max_load_factor(factor);
+    }
+    catch (std::out_of_range&)
+    {
+      thrown=true;
+    }
+    CHECK(thrown && sparse.max_load_factor()==2.0f);
+  }
+}
+
+}
+
+int main()
+{
+  auto number=[](int x) { return x; };
+  auto text=[](int x) { return "key:" + std::to_string(x); };
+  differential<std::hash<int>, int>(1, 3000, number);
+  differential<CollidingHash, int>(2, 300, number);
+  differential<std::hash<std::string>, std::string>(3, 2000, text);
+  growth();
+  insertionOrder(4);
+  pluggableHash();
+  capacity();
+  return 0;
+}
@@ -0,0 +1,284 @@
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "IntrusiveList.h"
+#include "Check.h"
+
+using namespace Linear;
+
+namespace
+{
+
+struct ByAge {};
+struct ByName {};
+
+// In up to two lists at once, one per hook.
+struct Entry : IntrusiveListHook<ByAge>, IntrusiveListHook<ByName>
+{
+  int id;
+
+  explicit Entry(int id) : id(id)
+  {}
+};
+
+template <typename Tag>
+bool linked(const Entry& entry)
+{
+  return static_cast<const IntrusiveListHook<Tag>&>(entry).isLinked();
+}
+
+template <typename Tag>
+void checkEqual(const IntrusiveList<Entry, Tag>& list, const std::list<int>& reference,
+                const std::vector<Entry>& entries)
+{
+  CHECK(list.getSize()==reference.size());
+  CHECK(list.isEmpty()==reference.empty());
+  auto it=list.begin();
+  for (int id : reference)
+  {
+    CHECK(it!=list.end());
+    CHECK(it->id==id && &*it==&entries[id]);
+    ++it;
+  }
+  CHECK(it==list.end());
+}
+
+// Exactly the objects in the list of this tag report being linked.
+template <typename Tag>
+void checkLinked(const std::list<int>& reference, const std::vector<Entry>& entries)
+{
+  std::size_t count=0;
+  for (const Entry& entry : entries)
+    count+=linked<Tag>(entry);
+  CHECK(count==reference.size());
+}
+
+template <typename Tag>
+bool throwsLogicError(IntrusiveList<Entry, Tag>& list, Entry& entry, int operation)
+{
+  try
+  {
+    if (operation==0)
+      list.erase(entry);
+    else if (operation==1)
+      list.iteratorTo(entry);
+    else
+      list.append(entry);
+  }
+  catch (std::logic_error&)
+  {
+    return true;
+  }
+  return false;
+}
+
+// Applies the same random operations to an IntrusiveList and a std::list of
+// the ids it holds.
+template <typename Tag>
+void step(std::mt19937& random, IntrusiveList<Entry, Tag>& list, std::list<int>& reference,
+          std::vector<Entry>& entries)
+{
+  Entry& entry=entries[random()%entries.size()];
+  std::size_t size=reference.size();
+  std::size_t at=random()%(size+1);
+  auto position=std::next(list.begin(), at);
+  auto referencePosition=std::next(reference.begin(), at);
+  switch (random()%9)
+  {
+  case 0:
+  case 1:
+    if (linked<Tag>(entry))
+      CHECK(throwsLogicError(list, entry, 2));
+    else if (random()%2==0)
+    {
+      list.append(entry);
+      reference.push_back(entry.id);
+    }
+    else
+    {
+      list.prepend(entry);
+      reference.push_front(entry.id);
+    }
+    break;
+  case 2:
+    if (!linked<Tag>(entry))
+    {
+      list.insert(position, entry);
+      reference.insert(referencePosition, entry.id);
+    }
+    break;
+  case 3:
+    if (linked<Tag>(entry))
+    {
+      CHECK(&*list.iteratorTo(entry)==&entry);
+      list.erase(entry);
+      reference.remove(entry.id);
+    }
+    else
+    {
+      CHECK(throwsLogicError(list, entry, 0));
+      CHECK(throwsLogicError(list, entry, 1));
+    }
+    break;
+  case 4:
+    if (at!=size)
+    {
+      list.erase(position);
+      reference.erase(referencePosition);
+    }
+    break;
+  case 5:
+  {
+    std::size_t count=random()%(size-at+1);
+    list.erase(position, std::next(position, count));
+    reference.erase(referencePosition, std::next(referencePosition, count));
+    break;
+  }
+  case 6:
+    if (size!=0)
+    {
+      bool first=random()%2==0;
+      Entry& popped= first ? list.popFirst() : list.popLast();
+      CHECK(popped.id==(first ? reference.front() : reference.back()));
+      CHECK(!linked<Tag>(popped));
+      if (first)
+        reference.pop_front();
+      else
+        reference.pop_back();
+    }
+    break;
+  case 7:
+  {
+    IntrusiveList<Entry, Tag> moved(std::move(list));
+    CHECK(list.isEmpty() && list.getSize()==0);
+    checkEqual(moved, reference, entries);
+    if (size!=0)
+      CHECK(&*moved.iteratorTo(entries[reference.front()])==&entries[reference.front()]);
+    list=std::move(moved);
+    CHECK(moved.isEmpty());
+    break;
+  }
+  default:
+  {
+    // Moving onto a non-empty list unlinks what it held.
+    IntrusiveList<Entry, Tag> other;
+    if (!linked<Tag>(entry))
+      other.append(entry);
+    other=std::move(list);
+    list=std::move(other);
+    CHECK(other.isEmpty());
+  }
+  }
+}
+
+void differential(unsigned seed)
+{
+  std::mt19937 random(seed);
+  std::vector<Entry> entries;
+  for (int id=0;id<200;id++)
+    entries.emplace_back(id);
+  IntrusiveList<Entry, ByAge> byAge;
+  IntrusiveList<Entry, ByName> byName;
+  std::list<int> ageReference, nameReference;
+  for (int i=0;i<20000;i++)
+  {
+    // Membership in one list does not affect the other.
+    if (random()%2==0)
+      step(random, byAge, ageReference, entries);
+    else
+      step(random, byName, nameReference, entries);
+    checkEqual(byAge, ageReference, entries);
+    checkEqual(byName, nameReference, entries);
+    checkLinked<ByAge>(ageReference, entries);
+    checkLinked<ByName>(nameReference, entries);
+  }
+
+  // Destroying a list unlinks its objects.
+  {
+    IntrusiveList<Entry, ByAge> scoped(std::move(byAge));
+  }
+  for (const Entry& entry : entries)
+    CHECK(!linked<ByAge>(entry));
+  checkEqual(byName, nameReference, entries);
+}
+
+// With checks on, objects and positions of another list are caught before
+// either list is changed.
+void wrongList()
+{
+#if LINEAR_CHECKED_ITERATORS
+  std::vector<Entry> entries;
+  for (int id=0;id<6;id++)
+    entries.emplace_back(id);
+  IntrusiveList<Entry, ByAge> mine, theirs;
+  std::list<int> mineReference, theirsReference;
+  for (int id=0;id<3;id++)
+  {
+    mine.append(entries[id]);
+    mineReference.push_back(id);
+    theirs.append(entries[id+3]);
+    theirsReference.push_back(id+3);
+  }
+  Entry& foreign=entries[4];
+  CHECK(throwsLogicError(mine, foreign, 0));
+  CHECK(throwsLogicError(mine, foreign, 1));
+  bool thrown=false;
+  try
+  {
+    mine.erase(theirs.iteratorTo(foreign));
+  }
+  catch (std::logic_error&)
+  {
+    thrown=true;
+  }
+  CHECK(thrown);
+  thrown=false;
+  try
+  {
+    mine.erase(theirs.begin(), theirs.end());
+  }
+  catch (std::logic_error&)
+  {
+    thrown=true;
+  }
+  CHECK(thrown);
+  thrown=false;
+  try
+  {
+    mine.erase(mine.begin(), theirs.iteratorTo(foreign));
+  }
+  catch (std::logic_error&)
+  {
+    thrown=true;
+  }
+  CHECK(thrown);
+  Entry spare(99);
+  thrown=false;
+  try
+  {
+    mine.insert(theirs.begin(), spare);
+  }
+  catch (std::logic_error&)
+  {
+    thrown=true;
+  }
+  CHECK(thrown && !linked<ByAge>(spare));
+  checkEqual(mine, mineReference, entries);
+  checkEqual(theirs, theirsReference, entries);
+#endif
+}
+
+}
+
+int main()
+{
+  differential(1);
+  differential(2);
+  wrongList();
+  return 0;
+}
@@ -0,0 +1,313 @@
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "LinkedList.h"
+#include "PoolAllocator.h"
+#include "Check.h"
+
+using namespace Linear;
+
+namespace
+{
+
+// Counts live objects and catches an object destroyed twice, so that a
+// missed or doubled destructor shows up.
+struct Counted
+{
+  static const unsigned ALIVE = 0x600dcafe;
+  static long live;
+  unsigned state;
+  std::string value;
+
+  Counted() : Counted(std::string())
+  {}
+
+  Counted(std::string value) : state(ALIVE), value(std::move(value))
+  {
+    live++;
+  }
+
+  Counted(const Counted& other) : state(ALIVE), value(other.value)
+  {
+    live++;
+  }
+
+  Counted(Counted&& other) noexcept : state(ALIVE), value(std::move(other.value))
+  {
+    live++;
+  }
+
+  Counted& operator=(const Counted&) = default;
+  Counted& operator=(Counted&&) = default;
+
+  ~Counted()
+  {
+    CHECK(state==ALIVE);
+    state=0;
+    live--;
+  }
+
+  bool operator==(const Counted& other) const
+  {
+    return value==other.value;
+  }
+
+  bool operator<(const Counted& other) const
+  {
+    return value<other.value;
+  }
+};
+
+long Counted::live=0;
+
+template <typename List, typename Type>
+void checkEqual(const List& list, const std::list<Type>& reference)
+{
+  CHECK(list.getSize()==reference.size());
+  CHECK(list.isEmpty()==reference.empty());
+  auto it=list.begin();
+  for (const Type& value : reference)
+  {
+    CHECK(it!=list.end());
+    CHECK(*it==value);
+    ++it;
+  }
+  CHECK(it==list.end());
+}
+
+// Applies the same random operations to a LinkedList and a std::list and
+// checks the O(1) size after every one of them.
+template <typename List, typename Type, typename Make>
+void differential(unsigned seed, Make make)
+{
+  std::mt19937 random(seed);
+  List list;
+  std::list<Type> reference;
+  for (int step=0;step<20000;step++)
+  {
+    Type value=make(random());
+    std::size_t size=reference.size();
+    std::size_t at=random()%(size+1);
+    switch (random()%10)
+    {
+    case 0:
+    case 1:
+      list.append(value);
+      reference.push_back(value);
+      break;
+    case 2:
+      list.prepend(value);
+      reference.push_front(value);
+      break;
+    case 3:
+      list.insert(list.begin()+at, value);
+      reference.insert(std::next(reference.begin(), at), value);
+      break;
+    case 4:
+      if (size!=0 && at!=size)
+      {
+        list.erase(list.begin()+at);
+        reference.erase(std::next(reference.begin(), at));
+      }
+      break;
+    case 5:
+    {
+      std::size_t last=at+random()%(size-at+1);
+      if (random()%50==0)
+      {
+        at=0;
+        last=size;
+      }
+      list.erase(list.begin()+at, list.begin()+last);
+      reference.erase(std::next(reference.begin(), at), std::next(reference.begin(), last));
+      break;
+    }
+    case 6:
+    {
+      bool thrown=false;
+      try
+      {
+        Type first=list.popFirst();
+        CHECK(size!=0 && first==reference.front());
+        reference.pop_front();
+      }
+      catch (std::out_of_range&)
+      {
+        thrown=true;
+      }
+      CHECK(thrown==(size==0));
+      break;
+    }
+    case 7:
+      if (size!=0)
+      {
+        CHECK(list.popLast()==reference.back());
+        reference.pop_back();
+      }
+      break;
+    case 8:
+    {
+      List moved(std::move(list));
+      CHECK(list.getSize()==0 && list.isEmpty());
+      checkEqual(moved, reference);
+      if (random()%2==0)
+      {
+        list=std::move(moved);
+        CHECK(moved.getSize()==0);
+      }
+      else
+      {
+        list=moved;
+        checkEqual(moved, reference);
+      }
+      break;
+    }
+    default:
+    {
+      List copy(list);
+      checkEqual(copy, reference);
+      copy.append(value);
+      CHECK(copy.getSize()==size+1);
+      list=std::move(copy);
+      list.popLast();
+    }
+    }
+    checkEqual(list, reference);
+  }
+}
+
+// Applies the same random splices, merges, sorts and splits to two
+// LinkedLists made by make and to two std::lists. Elements are ordered by
+// their last digit only, so that unstable sorting or merging shows up.
+template <typename List, typename Make>
+void relinking(unsigned seed, Make make)
+{
+  auto lastDigit=[](int a, int b) { return a%10<b%10; };
+  std::mt19937 random(seed);
+  List list=make();
+  List other=make();
+  std::list<int> reference, otherReference;
+  for (int step=0;step<5000;step++)
+  {
+    std::size_t size=reference.size();
+    std::size_t otherSize=otherReference.size();
+    std::size_t at=random()%(size+1);
+    std::size_t from=random()%(otherSize+1);
+    switch (random()%8)
+    {
+    case 0:
+    case 1:
+      for (int i=random()%20;i>0;i--)
+      {
+        int value=static_cast<int>(random()%1000);
+        other.append(value);
+        otherReference.push_back(value);
+      }
+      break;
+    case 2:
+      if (random()%4==0)
+      {
+        list.splice(list.begin()+at, other);
+        reference.splice(std::next(reference.begin(), at), otherReference);
+      }
+      else if (from!=otherSize)
+      {
+        list.splice(list.begin()+at, other, other.begin()+from);
+        reference.splice(std::next(reference.begin(), at), otherReference, std::next(otherReference.begin(), from));
+      }
+      break;
+    case 3:
+    {
+      std::size_t last=from+random()%(otherSize-from+1);
+      list.splice(list.begin()+at, other, other.begin()+from, other.begin()+last);
+      reference.splice(std::next(reference.begin(), at), otherReference, std::next(otherReference.begin(), from),
+                       std::next(otherReference.begin(), last));
+      break;
+    }
+    case 4:
+      // Within one list: moves the element at from in front of at.
+      if (size!=0)
+      {
+        from=random()%size;
+        list.splice(list.begin()+at, list, list.begin()+from);
+        reference.splice(std::next(reference.begin(), at), reference, std::next(reference.begin(), from));
+      }
+      break;
+    case 5:
+      list.sort(lastDigit);
+      reference.sort(lastDigit);
+      other.sort(lastDigit);
+      otherReference.sort(lastDigit);
+      if (random()%2==0)
+        list.merge(other, lastDigit);
+      else
+        list.merge(std::move(other), lastDigit);
+      reference.merge(otherReference, lastDigit);
+      break;
+    case 6:
+    {
+      List tail=list.split_at(list.begin()+at);
+      std::list<int> tailReference;
+      tailReference.splice(tailReference.end(), reference, std::next(reference.begin(), at), reference.end());
+      checkEqual(tail, tailReference);
+      // Elements appended to the split-off list must not show up here.
+      tail.append(-1);
+      tailReference.push_back(-1);
+      if (random()%2==0)
+      {
+        other.splice(other.end(), tail);
+        otherReference.splice(otherReference.end(), tailReference);
+      }
+      else
+      {
+        other=std::move(tail);
+        otherReference=tailReference;
+      }
+      break;
+    }
+    default:
+      if (random()%2==0)
+      {
+        list.sort();
+        reference.sort();
+      }
+      else
+      {
+        other.sort(lastDigit);
+        otherReference.sort(lastDigit);
+      }
+    }
+    checkEqual(list, reference);
+    checkEqual(other, otherReference);
+  }
+}
+
+}
+
+int main()
+{
+  auto text=[](unsigned x) { return std::string(x%3==0 ? 40 : 3, static_cast<char>('a'+x%26)); };
+  auto counted=[&](unsigned x) { return Counted(text(x)); };
+  using Pool = Memory::PoolAllocator<Counted>;
+  for (unsigned seed=0;seed<2;seed++)
+  {
+    differential<LinkedList<int>, int>(seed, [](unsigned x) { return static_cast<int>(x); });
+    differential<LinkedList<std::string>, std::string>(seed, text);
+    differential<LinkedList<Counted>, Counted>(seed, counted);
+    differential<LinkedList<Counted, Pool>, Counted>(seed, counted);
+  }
+  CHECK(Counted::live==0);
+
+  using IntPool = Memory::PoolAllocator<int>;
+  IntPool shared;
+  relinking<LinkedList<int>>(1, [] { return LinkedList<int>(); });
+  // Equal allocators relink nodes, distinct ones move the elements.
+  relinking<LinkedList<int, IntPool>>(2, [&shared] { return LinkedList<int, IntPool>(shared); });
+  relinking<LinkedList<int, IntPool>>(3, [] { return LinkedList<int, IntPool>(); });
+  return 0;
+}
@@ -0,0 +1,178 @@
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "PersistentTreeMap.h"
+#include "Check.h"
+
+using namespace Maps;
+
+namespace
+{
+
+using Map = PersistentTreeMap<int, std::string>;
+using Reference = std::map<int, std::string>;
+
+// Walks the snapshot forwards and backwards and looks every key up.
+void checkEqual(const Map::Snapshot& snapshot, const Reference& reference)
+{
+  CHECK(snapshot.getSize()==reference.size());
+  CHECK(snapshot.isEmpty()==reference.empty());
+  auto it=snapshot.begin();
+  for (const auto& entry : reference)
+  {
+    CHECK(it!=snapshot.end());
+    CHECK(it->first==entry.first && it->second==entry.second);
+    CHECK(snapshot.find(entry.first)==it);
+    CHECK(snapshot.valueOf(entry.first)==entry.second);
+    ++it;
+  }
+  CHECK(it==snapshot.end());
+  for (auto entry=reference.rbegin();entry!=reference.rend();++entry)
+  {
+    --it;
+    CHECK(it->first==entry->first);
+  }
+  CHECK(it==snapshot.begin());
+  bool thrown=false;
+  try
+  {
+    --it;
+  }
+  catch (std::out_of_range&)
+  {
+    thrown=true;
+  }
+  CHECK(thrown && it==snapshot.begin());
+}
+
+// Applies the same random updates to a PersistentTreeMap and a std::map,
+// and keeps some snapshots with a copy of the std::map at that time; later
+// updates must not change them.
+void differential(unsigned seed)
+{
+  std::mt19937 random(seed);
+  Map map;
+  Reference reference;
+  std::vector<std::pair<Map::Snapshot, Reference>> kept;
+  for (int step=0;step<20000;step++)
+  {
+    int key=static_cast<int>(random()%400);
+    std::string value=std::to_string(random()%1000);
+    switch (random()%6)
+    {
+    case 0:
+    case 1:
+      CHECK(map.insert_or_assign(key, value)==(reference.count(key)==0));
+      reference[key]=value;
+      break;
+    case 2:
+      CHECK(map.try_emplace(key, value)==reference.emplace(key, value).second);
+      break;
+    case 3:
+    {
+      bool present=reference.erase(key)!=0;
+      bool thrown=false;
+      try
+      {
+        map.remove(key);
+      }
+      catch (std::out_of_range&)
+      {
+        thrown=true;
+      }
+      CHECK(thrown!=present);
+      break;
+    }
+    case 4:
+    {
+      CHECK(map.contains(key)==(reference.count(key)!=0));
+      CHECK(map.getSize()==reference.size());
+      if (random()%500==0)
+      {
+        map.erase();
+        reference.clear();
+      }
+      break;
+    }
+    default:
+      if (random()%20==0)
+      {
+        if (kept.size()==16)
+          kept.erase(kept.begin()+random()%kept.size());
+        kept.emplace_back(map.snapshot(), reference);
+      }
+    }
+    if (step%500==0)
+    {
+      checkEqual(map.snapshot(), reference);
+      for (const auto& version : kept)
+        checkEqual(version.first, version.second);
+    }
+  }
+
+  // Copies share nodes but not updates.
+  Map copy(map);
+  copy.insert_or_assign(-1, "copy");
+  CHECK(!map.contains(-1) && copy.getSize()==reference.size()+1);
+  map=copy;
+  CHECK(map==copy && map.valueOf(-1)=="copy");
+  for (const auto& version : kept)
+    checkEqual(version.first, version.second);
+}
+
+// One writer inserts the keys 0..KEYS-1 in order and then removes them in
+// order, so that every version holds a consecutive range of keys, each
+// mapped to twice itself. Readers check the snapshots they take meanwhile.
+void concurrentReaders()
+{
+  const int KEYS=20000;
+  const unsigned READERS=4;
+  PersistentTreeMap<int, int> map;
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (unsigned reader=0;reader<READERS;reader++)
+    readers.emplace_back([&map, &done] {
+      int rounds=0;
+      while (!done.load() || rounds==0)
+      {
+        rounds++;
+        auto snapshot=map.snapshot();
+        std::size_t count=0;
+        int previous=0;
+        for (auto it=snapshot.begin();it!=snapshot.end();++it, ++count)
+        {
+          CHECK(it->second==2*it->first);
+          CHECK(count==0 || it->first==previous+1);
+          previous=it->first;
+        }
+        CHECK(count==snapshot.getSize());
+        if (count!=0)
+          CHECK(snapshot.contains(previous) && !snapshot.contains(previous+1));
+      }
+    });
+  for (int key=0;key<KEYS;key++)
+    map.insert_or_assign(key, 2*key);
+  for (int key=0;key<KEYS;key++)
+    map.remove(key);
+  done.store(true);
+  for (std::thread& reader : readers)
+    reader.join();
+  CHECK(map.isEmpty());
+}
+
+}
+
+int main()
+{
+  differential(1);
+  differential(2);
+  concurrentReaders();
+  return 0;
+}
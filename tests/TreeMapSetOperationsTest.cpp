@@ -0,0 +1,233 @@
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "PoolAllocator.h"
+#include "TreeMap.h"
+#include "Check.h"
+
+using namespace Maps;
+
+namespace
+{
+
+using Reference = std::map<int, std::string>;
+
+template <typename Map>
+void checkEqual(const Map& map, const Reference& reference)
+{
+  CHECK(map.getSize()==reference.size());
+  auto it=map.begin();
+  for (const auto& entry : reference)
+  {
+    CHECK(it!=map.end());
+    CHECK(it->first==entry.first && it->second==entry.second);
+    ++it;
+  }
+  CHECK(it==map.end());
+  if (!reference.empty())
+  {
+    auto last=map.end();
+    --last;
+    CHECK(last->first==reference.rbegin()->first);
+  }
+}
+
+// Subtree sizes must survive split and join.
+template <typename Map>
+void checkRanks(const Map& map, std::true_type)
+{
+  std::size_t rank=0;
+  for (auto it=map.begin();it!=map.end();++it, ++rank)
+  {
+    CHECK(map.rank(it->first)==rank);
+    CHECK(map.select(rank)==it);
+  }
+}
+
+template <typename Map>
+void checkRanks(const Map&, std::false_type)
+{}
+
+// Compares union, intersection and difference, of copies and of moved
+// trees, with the same operations on std::map. Union keeps the values of
+// the map operated on.
+template <typename Map, typename HasRanks>
+void differential(unsigned seed)
+{
+  std::mt19937 random(seed);
+  for (int round=0;round<200;round++)
+  {
+    // Sizes from tiny to a few thousand, so both the m << n and the m ~ n
+    // cases come up, over key ranges that make overlaps sparse or dense.
+    int sizeA=static_cast<int>(random()%(round<100 ? 3000 : 50));
+    int sizeB=static_cast<int>(random()%(round%3!=0 ? 3000 : 40));
+    int keys=static_cast<int>(random()%8000+10);
+    Reference a, b;
+    Map mapA, mapB;
+    for (int i=0;i<sizeA;i++)
+    {
+      int key=static_cast<int>(random()%keys);
+      a[key]="a"+std::to_string(i);
+      mapA[key]=a[key];
+    }
+    for (int i=0;i<sizeB;i++)
+    {
+      int key=static_cast<int>(random()%keys);
+      b[key]="b"+std::to_string(i);
+      mapB[key]=b[key];
+    }
+
+    Reference expected;
+    bool move=random()%2==0;
+    switch (random()%3)
+    {
+    case 0:
+      expected=a;
+      expected.insert(b.begin(), b.end());
+      if (move)
+        mapA.uniteWith(std::move(mapB));
+      else
+        mapA.uniteWith(mapB);
+      break;
+    case 1:
+      for (const auto& entry : a)
+        if (b.count(entry.first)!=0)
+          expected.insert(entry);
+      if (move)
+        mapA.intersectWith(std::move(mapB));
+      else
+        mapA.intersectWith(mapB);
+      break;
+    default:
+      for (const auto& entry : a)
+        if (b.count(entry.first)==0)
+          expected.insert(entry);
+      if (move)
+        mapA.subtract(std::move(mapB));
+      else
+        mapA.subtract(mapB);
+    }
+    checkEqual(mapA, expected);
+    checkRanks(mapA, HasRanks());
+    if (move)
+      CHECK(mapB.isEmpty());
+    else
+      checkEqual(mapB, b);
+
+    // The result must still be a working tree.
+    mapA[-5]="n";
+    expected[-5]="n";
+    mapA.remove(mapA.begin());
+    expected.erase(expected.begin());
+    checkEqual(mapA, expected);
+  }
+
+  Map self;
+  self[1]="a";
+  self.uniteWith(self);
+  self.intersectWith(self);
+  CHECK(self.getSize()==1);
+  self.subtract(self);
+  CHECK(self.isEmpty());
+}
+
+// Records which threads compare keys, to tell whether a set operation was
+// split between threads.
+struct TrackedKey
+{
+  static std::mutex lock;
+  static std::set<std::thread::id> threads;
+  int value;
+
+  bool operator<(const TrackedKey& other) const
+  {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      threads.insert(std::this_thread::get_id());
+    }
+    return value<other.value;
+  }
+};
+
+std::mutex TrackedKey::lock;
+std::set<std::thread::id> TrackedKey::threads;
+
+// Maps built from sorted ranges are perfectly balanced, so at this size
+// their black height is well above the fork cutoff and an explicit thread
+// count forks even on a single core.
+void forked(unsigned seed)
+{
+  using Map = TreeMap<TrackedKey, int>;
+  std::mt19937 random(seed);
+  for (unsigned threads : {1u, 2u, 3u, 4u, 8u})
+    for (int operation=0;operation<3;operation++)
+    {
+      std::map<int, int> a, b;
+      while (a.size()<20000)
+        a[static_cast<int>(random()%60000)]=1;
+      while (b.size()<15000)
+        b[static_cast<int>(random()%60000)]=2;
+      std::vector<std::pair<TrackedKey, int>> entriesA, entriesB;
+      for (const auto& entry : a)
+        entriesA.emplace_back(TrackedKey{entry.first}, entry.second);
+      for (const auto& entry : b)
+        entriesB.emplace_back(TrackedKey{entry.first}, entry.second);
+      Map mapA(entriesA.begin(), entriesA.end());
+      Map mapB(entriesB.begin(), entriesB.end());
+
+      std::map<int, int> expected;
+      TrackedKey::threads.clear();
+      if (operation==0)
+      {
+        expected=a;
+        expected.insert(b.begin(), b.end());
+        mapA.uniteWith(std::move(mapB), threads);
+      }
+      else if (operation==1)
+      {
+        for (const auto& entry : a)
+          if (b.count(entry.first)!=0)
+            expected.insert(entry);
+        mapA.intersectWith(mapB, threads);
+      }
+      else
+      {
+        for (const auto& entry : a)
+          if (b.count(entry.first)==0)
+            expected.insert(entry);
+        mapA.subtract(mapB, threads);
+      }
+      CHECK((TrackedKey::threads.size()>1)==(threads>1));
+      CHECK(TrackedKey::threads.size()<=threads);
+
+      CHECK(mapA.getSize()==expected.size());
+      auto it=mapA.begin();
+      for (const auto& entry : expected)
+      {
+        CHECK(it->first.value==entry.first && it->second==entry.second);
+        ++it;
+      }
+      CHECK(it==mapA.end());
+    }
+}
+
+}
+
+int main()
+{
+  using Allocator = std::allocator<std::pair<int, std::string>>;
+  using Pool = Memory::PoolAllocator<std::pair<int, std::string>>;
+  differential<TreeMap<int, std::string>, std::false_type>(1);
+  differential<TreeMap<int, std::string, Pool>, std::false_type>(2);
+  differential<TreeMap<int, std::string, Allocator, OrderStatistics>, std::true_type>(3);
+  forked(4);
+  return 0;
+}
@@ -0,0 +1,550 @@
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "PoolAllocator.h"
+#include "TreeMap.h"
+#include "Check.h"
+
+using namespace Maps;
+
+namespace
+{
+
+using Reference = std::map<int, std::string>;
+
+template <typename Map>
+void checkEqual(const Map& map, const Reference& reference)
+{
+  CHECK(map.getSize()==reference.size());
+  CHECK(map.isEmpty()==reference.empty());
+  auto it=map.begin();
+  for (const auto& entry : reference)
+  {
+    CHECK(it!=map.end());
+    CHECK(it->first==entry.first && it->second==entry.second);
+    ++it;
+  }
+  CHECK(it==map.end());
+}
+
+template <typename Map>
+Map filled(int first, int count, Reference& reference)
+{
+  Map map;
+  reference.clear();
+  for (int key=first;key<first+count;key++)
+  {
+    map[key]=std::to_string(key);
+    reference[key]=std::to_string(key);
+  }
+  return map;
+}
+
+// A moved-from map must still be assignable, copyable and destructible;
+// std::swap relies on it.
+template <typename Map>
+void movedFrom()
+{
+  Reference a, b;
+  Map mapA=filled<Map>(0, 100, a);
+  Map mapB=filled<Map>(50, 7, b);
+  std::swap(mapA, mapB);
+  checkEqual(mapA, b);
+  checkEqual(mapB, a);
+
+  Map taken(std::move(mapA));
+  checkEqual(taken, b);
+  checkEqual(mapA, Reference());
+  mapA=std::move(taken);
+  checkEqual(mapA, b);
+
+  Map other(std::move(mapA));
+  mapA=mapB;
+  checkEqual(mapA, a);
+  Map copied(std::move(mapA));
+  Map copy(mapA);
+  checkEqual(copy, Reference());
+  mapA=copy;
+  checkEqual(mapA, Reference());
+  mapA[1]="one";
+  CHECK(mapA.getSize()==1 && mapA.find(1)->second=="one");
+
+  Map empty(std::move(mapB));
+  mapB={{3, "three"}};
+  CHECK(mapB.getSize()==1);
+  mapA=std::move(empty);
+  checkEqual(mapA, a);
+}
+
+// The iterator points at the same entry as the std::map one, or both are
+// at the end.
+template <typename Iterator, typename ReferenceIterator, typename Map>
+void checkSame(Iterator it, ReferenceIterator expected, const Map& map, const Reference& reference)
+{
+  CHECK((it==map.end())==(expected==reference.end()));
+  if (expected!=reference.end())
+    CHECK(it->first==expected->first && it->second==expected->second);
+}
+
+template <typename Map>
+bool throwsOutOfRange(const Map& map, bool first)
+{
+  try
+  {
+    if (first)
+      map.first();
+    else
+      map.last();
+  }
+  catch (std::out_of_range&)
+  {
+    return true;
+  }
+  return false;
+}
+
+// Compares bounds, floor, ceiling, first, last and forEachInRange with
+// std::map while the map changes, probing keys present and missing and
+// beyond either end.
+void rangeQueries(unsigned seed)
+{
+  std::mt19937 random(seed);
+  TreeMap<int, std::string> map;
+  const auto& constMap=map;
+  Reference reference;
+  CHECK(throwsOutOfRange(map, true) && throwsOutOfRange(map, false));
+  for (int step=0;step<3000;step++)
+  {
+    int key=static_cast<int>(random()%400);
+    if (random()%3!=0)
+    {
+      map[key]=std::to_string(step);
+      reference[key]=std::to_string(step);
+    }
+    else if (reference.erase(key)!=0)
+      map.remove(key);
+    if (step%10!=0)
+      continue;
+
+    for (int probe=0;probe<20;probe++)
+    {
+      int k=static_cast<int>(random()%420)-10;
+      checkSame(map.lower_bound(k), reference.lower_bound(k), map, reference);
+      checkSame(constMap.lower_bound(k), reference.lower_bound(k), map, reference);
+      checkSame(map.upper_bound(k), reference.upper_bound(k), map, reference);
+      checkSame(constMap.upper_bound(k), reference.upper_bound(k), map, reference);
+      auto range=map.equal_range(k);
+      CHECK(range.first==map.lower_bound(k) && range.second==map.upper_bound(k));
+      auto constRange=constMap.equal_range(k);
+      CHECK(constRange.first==range.first && constRange.second==range.second);
+      checkSame(map.ceiling(k), reference.lower_bound(k), map, reference);
+      checkSame(constMap.ceiling(k), reference.lower_bound(k), map, reference);
+      auto floor=reference.upper_bound(k);
+      floor= floor==reference.begin() ? reference.end() : std::prev(floor);
+      checkSame(map.floor(k), floor, map, reference);
+      checkSame(constMap.floor(k), floor, map, reference);
+    }
+
+    if (reference.empty())
+      CHECK(throwsOutOfRange(map, true) && throwsOutOfRange(map, false));
+    else
+      CHECK(map.first().first==reference.begin()->first && map.last().first==reference.rbegin()->first);
+
+    // Visits [low, high) in order; the mutable overload can change values.
+    int low=static_cast<int>(random()%420)-10;
+    int high=low+static_cast<int>(random()%100)-10;
+    std::vector<int> visited;
+    constMap.forEachInRange(low, high, [&visited](const std::pair<int, std::string>& entry) {
+      visited.push_back(entry.first);
+    });
+    std::vector<int> expected;
+    for (auto it=reference.lower_bound(low);it!=reference.end() && it->first<high;++it)
+    {
+      expected.push_back(it->first);
+      it->second+="!";
+    }
+    CHECK(visited==expected);
+    map.forEachInRange(low, high, [](std::pair<int, std::string>& entry) { entry.second+="!"; });
+    checkEqual(map, reference);
+  }
+}
+
+template <typename Operation>
+bool throwsOutOfRange(Operation operation)
+{
+  try
+  {
+    operation();
+  }
+  catch (std::out_of_range&)
+  {
+    return true;
+  }
+  return false;
+}
+
+// Subtree sizes must follow every kind of update; rank, select, advance and
+// distance are compared with positions in the sorted keys of a std::map.
+void orderStatistics(unsigned seed)
+{
+  using Map = TreeMap<int, std::string, std::allocator<std::pair<int, std::string>>, OrderStatistics>;
+  std::mt19937 random(seed);
+  Map map;
+  Reference reference;
+  for (int step=0;step<4000;step++)
+  {
+    int key=static_cast<int>(random()%600);
+    std::string value=std::to_string(step);
+    switch (random()%8)
+    {
+    case 0:
+    case 1:
+      map[key]=value;
+      reference[key]=value;
+      break;
+    case 2:
+      map.try_emplace(key, value);
+      reference.emplace(key, value);
+      break;
+    case 3:
+      if (reference.erase(key)!=0)
+        map.remove(key);
+      break;
+    case 4:
+      if (!reference.empty())
+      {
+        std::size_t k=random()%reference.size();
+        map.remove(map.select(k));
+        reference.erase(std::next(reference.begin(), k));
+      }
+      break;
+    case 5:
+    {
+      // Sorted ranges are built and merged without inserting one by one.
+      Reference extra;
+      for (int i=random()%50;i>0;i--)
+        extra[static_cast<int>(random()%600)]=value;
+      Map other;
+      other.assign(extra.begin(), extra.end());
+      if (random()%2==0)
+        map.merge(other);
+      else
+        map.merge(std::move(other));
+      reference.insert(extra.begin(), extra.end());
+      break;
+    }
+    case 6:
+      if (random()%20==0)
+      {
+        map.assign(reference.begin(), reference.end());
+        Map copy(map);
+        map=std::move(copy);
+      }
+      break;
+    default:
+      if (random()%200==0)
+      {
+        map.erase();
+        reference.clear();
+      }
+    }
+    if (step%20!=0)
+      continue;
+
+    std::vector<int> keys;
+    for (const auto& entry : reference)
+      keys.push_back(entry.first);
+    std::size_t size=keys.size();
+    CHECK(map.getSize()==size);
+    for (std::size_t i=0;i<size;i++)
+    {
+      CHECK(map.select(i)->first==keys[i]);
+      CHECK(map.rank(keys[i])==i && map.rank(keys[i]+1)==i+1);
+    }
+    CHECK(map.select(size)==map.end());
+    CHECK(throwsOutOfRange([&map, size] { map.select(size+1); }));
+    CHECK(map.distance(map.begin(), map.end())==static_cast<std::ptrdiff_t>(size));
+    for (int probe=0;probe<20;probe++)
+    {
+      std::ptrdiff_t from=static_cast<std::ptrdiff_t>(random()%(size+1));
+      std::ptrdiff_t to=static_cast<std::ptrdiff_t>(random()%(size+1));
+      auto first=map.select(from);
+      auto last=map.select(to);
+      CHECK(map.distance(first, last)==to-from);
+      CHECK(map.advance(first, to-from)==last);
+      const Map& constMap=map;
+      CHECK(constMap.advance(last, from-to)==first);
+      std::ptrdiff_t beyond=static_cast<std::ptrdiff_t>(size)-from+1+static_cast<std::ptrdiff_t>(random()%5);
+      CHECK(throwsOutOfRange([&] { map.advance(first, beyond); }));
+      CHECK(throwsOutOfRange([&] { map.advance(first, -from-1); }));
+    }
+  }
+  checkEqual(map, reference);
+}
+
+// A key that counts its comparisons, to tell a linear build from inserting
+// one key at a time.
+struct Key
+{
+  static long comparisons;
+  int value;
+
+  Key() : value(0)
+  {}
+
+  explicit Key(int value) : value(value)
+  {}
+
+  bool operator<(const Key& other) const
+  {
+    comparisons++;
+    return value<other.value;
+  }
+
+  bool operator>(const Key& other) const
+  {
+    return other<*this;
+  }
+
+  bool operator==(const Key& other) const
+  {
+    comparisons++;
+    return value==other.value;
+  }
+};
+
+long Key::comparisons=0;
+
+// Builds maps from sorted ranges of sizes around powers of two, where the
+// red level of the built tree changes, checks that they take updates like
+// any other map, and merges sorted maps into each other.
+template <typename Map>
+void bulkBuild(unsigned seed)
+{
+  std::mt19937 random(seed);
+  for (int n : {0, 1, 2, 3, 4, 7, 8, 9, 15, 16, 100, 511, 512, 1000})
+  {
+    std::vector<std::pair<int, std::string>> sorted;
+    Reference reference;
+    for (int i=0;i<n;i++)
+    {
+      sorted.emplace_back(3*i, std::to_string(i));
+      reference[3*i]=std::to_string(i);
+    }
+    Map map(sorted.begin(), sorted.end());
+    checkEqual(map, reference);
+    for (int step=0;step<300;step++)
+    {
+      int key=static_cast<int>(random()%(3*n+10));
+      if (random()%2==0)
+      {
+        map[key]="new";
+        reference[key]="new";
+      }
+      else if (reference.erase(key)!=0)
+        map.remove(key);
+    }
+    checkEqual(map, reference);
+
+    // Values are moved out through move iterators.
+    Map moved;
+    moved.assign(std::make_move_iterator(sorted.begin()), std::make_move_iterator(sorted.end()));
+    CHECK(moved.getSize()==static_cast<std::size_t>(n));
+
+    // After the first key out of order, later entries overwrite earlier ones.
+    std::vector<std::pair<int, std::string>> unsorted;
+    reference.clear();
+    for (int i=0;i<n+20;i++)
+    {
+      int key= i<n/2 ? i : static_cast<int>(random()%(n+20));
+      unsorted.emplace_back(key, std::to_string(i));
+      reference[key]=std::to_string(i);
+    }
+    map.assign(unsorted.begin(), unsorted.end());
+    checkEqual(map, reference);
+
+    // merge keeps this map's value for keys on both sides.
+    Reference theirs;
+    Map other;
+    for (int i=0;i<n;i++)
+      if (random()%2==0)
+      {
+        int key=static_cast<int>(random()%(2*n+20));
+        other[key]="theirs";
+        theirs[key]="theirs";
+      }
+    Reference merged=reference;
+    merged.insert(theirs.begin(), theirs.end());
+    Map copy(map);
+    copy.merge(other);
+    checkEqual(copy, merged);
+    checkEqual(other, theirs);
+    map.merge(std::move(other));
+    checkEqual(map, merged);
+    checkEqual(other, Reference());
+    map.merge(map);
+    checkEqual(map, merged);
+  }
+}
+
+// Building from n sorted keys compares each key with its predecessor only,
+// and merging compares a bounded number of times per key.
+void linearBuild()
+{
+  const int N=4096;
+  std::vector<std::pair<Key, int>> even, odd;
+  for (int i=0;i<N;i++)
+  {
+    even.emplace_back(Key(2*i), i);
+    odd.emplace_back(Key(2*i+1), i);
+  }
+  Key::comparisons=0;
+  TreeMap<Key, int> map(even.begin(), even.end());
+  TreeMap<Key, int> other(odd.begin(), odd.end());
+  CHECK(Key::comparisons<=2*N);
+  Key::comparisons=0;
+  map.merge(other);
+  CHECK(Key::comparisons<=3*2*N);
+  CHECK(map.getSize()==2*N);
+  int expected=0;
+  for (auto it=map.begin();it!=map.end();++it, ++expected)
+    CHECK(it->first.value==expected);
+}
+
+// begin(), --end(), first() and last() read the minimum and maximum kept
+// by the map; they must be right after every kind of update, above all
+// after removing the minimum or the maximum itself.
+template <typename Map>
+void checkExtremes(const Map& map, const Reference& reference)
+{
+  CHECK(map.getSize()==reference.size());
+  if (reference.empty())
+  {
+    CHECK(map.begin()==map.end());
+    return;
+  }
+  auto last=map.end();
+  --last;
+  CHECK(map.begin()->first==reference.begin()->first && last->first==reference.rbegin()->first);
+  CHECK(map.first().first==reference.begin()->first && map.last().first==reference.rbegin()->first);
+  CHECK(map.begin()==map.find(reference.begin()->first) && last==map.find(reference.rbegin()->first));
+}
+
+void extremes(unsigned seed)
+{
+  std::mt19937 random(seed);
+  TreeMap<int, std::string> map;
+  Reference reference;
+  for (int step=0;step<20000;step++)
+  {
+    int key=static_cast<int>(random()%300);
+    switch (random()%10)
+    {
+    case 0:
+    case 1:
+    case 2:
+      map[key]="x";
+      reference[key]="x";
+      break;
+    case 3:
+      if (reference.erase(key)!=0)
+        map.remove(key);
+      break;
+    case 4:
+      if (!reference.empty())
+      {
+        map.remove(map.begin());
+        reference.erase(reference.begin());
+      }
+      break;
+    case 5:
+      if (!reference.empty())
+      {
+        map.remove(std::prev(map.end()));
+        reference.erase(std::prev(reference.end()));
+      }
+      break;
+    case 6:
+      // Removing by key the minimum or maximum, which may have a child.
+      if (!reference.empty())
+      {
+        int extreme= random()%2==0 ? reference.begin()->first : reference.rbegin()->first;
+        map.remove(extreme);
+        reference.erase(extreme);
+      }
+      break;
+    case 7:
+    {
+      // Set operations rebuild the tree from split and joined pieces.
+      TreeMap<int, std::string> other;
+      Reference theirs;
+      int low=static_cast<int>(random()%300);
+      for (int i=random()%40;i>0;i--)
+      {
+        int k=low+static_cast<int>(random()%60)-30;
+        other[k]="y";
+        theirs[k]="y";
+      }
+      unsigned operation=random()%3;
+      if (operation==0)
+      {
+        map.uniteWith(other);
+        reference.insert(theirs.begin(), theirs.end());
+      }
+      else if (operation==1)
+      {
+        map.intersectWith(other);
+        for (auto it=reference.begin();it!=reference.end();)
+          it= theirs.count(it->first)==0 ? reference.erase(it) : std::next(it);
+      }
+      else
+      {
+        map.subtract(other);
+        for (const auto& entry : theirs)
+          reference.erase(entry.first);
+      }
+      break;
+    }
+    case 8:
+      if (random()%2==0)
+      {
+        TreeMap<int, std::string> copy(map);
+        checkExtremes(copy, reference);
+        map=std::move(copy);
+      }
+      else
+        map.assign(reference.begin(), reference.end());
+      break;
+    default:
+      if (random()%50==0)
+      {
+        map.erase();
+        reference.clear();
+      }
+    }
+    checkExtremes(map, reference);
+  }
+}
+
+}
+
+int main()
+{
+  using Pool = Memory::PoolAllocator<std::pair<int, std::string>>;
+  movedFrom<TreeMap<int, std::string>>();
+  movedFrom<TreeMap<int, std::string, Pool>>();
+  rangeQueries(1);
+  orderStatistics(2);
+  bulkBuild<TreeMap<int, std::string>>(3);
+  bulkBuild<TreeMap<int, std::string, Pool>>(4);
+  linearBuild();
+  extremes(5);
+  return 0;
+}
@@ -0,0 +1,212 @@
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "HashMap.h"
+#include "TreeMap.h"
+#include "Check.h"
+
+using namespace Maps;
+
+namespace
+{
+
+// A key that counts its comparisons, and a hash that counts its calls, so
+// that a second lookup inside one operation shows up.
+struct Key
+{
+  static long comparisons;
+  int value;
+
+  // TreeMap's guard node holds a default-constructed entry.
+  Key() : value(0)
+  {}
+
+  explicit Key(int value) : value(value)
+  {}
+
+  bool operator<(const Key& other) const
+  {
+    comparisons++;
+    return value<other.value;
+  }
+
+  bool operator>(const Key& other) const
+  {
+    return other<*this;
+  }
+
+  bool operator==(const Key& other) const
+  {
+    comparisons++;
+    return value==other.value;
+  }
+};
+
+long Key::comparisons=0;
+
+struct KeyHash
+{
+  static long calls;
+
+  std::size_t operator()(const Key& key) const
+  {
+    calls++;
+    return std::hash<int>()(key.value);
+  }
+};
+
+long KeyHash::calls=0;
+
+// Counts how mapped values come about.
+struct Tracked
+{
+  static long constructed;
+  static long assigned;
+  int value;
+
+  Tracked() : value(0)
+  {}
+
+  explicit Tracked(int value) : value(value)
+  {
+    constructed++;
+  }
+
+  Tracked(const Tracked& other) : value(other.value)
+  {
+    constructed++;
+  }
+
+  Tracked(Tracked&& other) noexcept : value(other.value)
+  {
+    constructed++;
+  }
+
+  Tracked& operator=(const Tracked& other)
+  {
+    value=other.value;
+    assigned++;
+    return *this;
+  }
+
+  Tracked& operator=(Tracked&& other) noexcept
+  {
+    value=other.value;
+    assigned++;
+    return *this;
+  }
+};
+
+long Tracked::constructed=0;
+long Tracked::assigned=0;
+
+const int KEYS=500;
+
+template <typename Map>
+void reserveFor(Map&, std::size_t)
+{}
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+void reserveFor(HashMap<KeyType, ValueType, Hash, KeyEqual>& map, std::size_t size)
+{
+  map.reserve(size);
+}
+
+// A new key gets its value constructed once, from the arguments; a present
+// key leaves the value alone (try_emplace) or assigns to it once
+// (insert_or_assign). The iterator returned points at the entry either way.
+template <typename Map, typename Owner>
+void constructsOnce()
+{
+  Map map;
+  reserveFor(map, 2*KEYS);
+  for (int key=0;key<KEYS;key++)
+  {
+    Tracked::constructed=0;
+    auto result=map.try_emplace(Key(key), key);
+    CHECK(result.second && result.first->first.value==key && result.first->second.value==key);
+    CHECK(Tracked::constructed==1 && Tracked::assigned==0);
+  }
+  Tracked replacement(-1);
+  for (int key=0;key<KEYS;key++)
+  {
+    Tracked::constructed=0;
+    auto result=map.try_emplace(Key(key), key+1);
+    CHECK(!result.second && result.first->first.value==key && result.first->second.value==key);
+    CHECK(Tracked::constructed==0 && Tracked::assigned==0);
+    result=map.insert_or_assign(Key(key), replacement);
+    CHECK(!result.second && result.first->second.value==-1);
+    CHECK(Tracked::constructed==0 && Tracked::assigned==1);
+    Tracked::assigned=0;
+    result=map.insert_or_assign(Key(key+KEYS), replacement);
+    CHECK(result.second && result.first->first.value==key+KEYS && result.first->second.value==-1);
+    CHECK(Tracked::constructed==1 && Tracked::assigned==0);
+  }
+  CHECK(map.getSize()==2*KEYS);
+
+  // Arguments are not moved from when the key is present.
+  Owner owner;
+  owner.try_emplace("one", new int(1));
+  std::string key="one";
+  std::unique_ptr<int> value(new int(2));
+  auto result=owner.try_emplace(std::move(key), std::move(value));
+  CHECK(!result.second && *result.first->second==1);
+  CHECK(key=="one" && value!=NULL && *value==2);
+  result=owner.try_emplace(std::move(key), std::move(value));
+  CHECK(!result.second && value!=NULL);
+  result=owner.insert_or_assign("one", std::move(value));
+  CHECK(!result.second && value==NULL && *owner.valueOf("one")==2);
+}
+
+// try_emplace and insert_or_assign hash the key once, whether it is
+// present or not.
+void hashesOnce()
+{
+  HashMap<Key, Tracked, KeyHash> map;
+  map.reserve(2*KEYS);
+  for (int key=0;key<2*KEYS;key++)
+  {
+    KeyHash::calls=0;
+    if (key%2==0)
+      map.try_emplace(Key(key/2), key);
+    else
+      map.insert_or_assign(Key(key/2), Tracked(key));
+    CHECK(KeyHash::calls==1);
+  }
+}
+
+// try_emplace and insert_or_assign descend once: they compare no more than
+// find, plus the comparison that attaches a new node and one at the match.
+void descendsOnce()
+{
+  TreeMap<Key, Tracked> map;
+  for (int round=0;round<2;round++)
+    for (int i=0;i<KEYS;i++)
+    {
+      // Keys in a scattered order, so that the tree has depth on both sides.
+      int key=(i*7919)%KEYS;
+      Key::comparisons=0;
+      map.find(Key(key));
+      long lookup=Key::comparisons;
+      Key::comparisons=0;
+      if (round==0)
+        map.try_emplace(Key(key), key);
+      else
+        map.insert_or_assign(Key(key), Tracked(key));
+      CHECK(Key::comparisons<=lookup+2);
+    }
+}
+
+}
+
+int main()
+{
+  constructsOnce<HashMap<Key, Tracked, KeyHash>, HashMap<std::string, std::unique_ptr<int>>>();
+  constructsOnce<TreeMap<Key, Tracked>, TreeMap<std::string, std::unique_ptr<int>>>();
+  hashesOnce();
+  descendsOnce();
+  return 0;
+}
@@ -0,0 +1,145 @@
+#include <iterator>
+#include <list>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "UnrolledList.h"
+#include "Check.h"
+
+using namespace Linear;
+
+namespace
+{
+
+template <typename List, typename Reference>
+void checkEqual(const List& list, const Reference& reference)
+{
+  CHECK(list.getSize()==reference.size());
+  CHECK(list.isEmpty()==reference.empty());
+  auto it=list.begin();
+  for (const auto& value : reference)
+  {
+    CHECK(it!=list.end());
+    CHECK(*it==value);
+    ++it;
+  }
+  CHECK(it==list.end());
+  auto back=list.end();
+  for (auto value=reference.rbegin();value!=reference.rend();++value)
+    CHECK(*--back==*value);
+  CHECK(back==list.begin());
+}
+
+// Applies the same random operations to an UnrolledList and a std::list.
+template <typename Type, std::size_t ChunkBytes, typename Make>
+void differential(unsigned seed, Make make)
+{
+  std::mt19937 random(seed);
+  UnrolledList<Type, ChunkBytes> list;
+  std::list<Type> reference;
+  for (int step=0;step<40000;step++)
+  {
+    if (step%97==0)
+      checkEqual(list, reference);
+    // Alternately grows to thousands of elements and shrinks back.
+    bool growing=step/5000%2==0;
+    std::size_t size=reference.size();
+    std::size_t at=size==0 ? 0 : random()%(size+1);
+    unsigned operation=random()%100;
+    if (operation<(growing ? 85u : 30u) || size<8)
+    {
+      Type value=make(random());
+      if (operation%3==0)
+      {
+        list.append(value);
+        reference.push_back(value);
+      }
+      else if (operation%3==1)
+      {
+        list.prepend(value);
+        reference.push_front(value);
+      }
+      else
+      {
+        list.insert(list.begin()+at, value);
+        reference.insert(std::next(reference.begin(), at), value);
+      }
+      continue;
+    }
+    switch (operation%4)
+    {
+    case 0:
+      if (at==size)
+        at--;
+      list.erase(list.begin()+at);
+      reference.erase(std::next(reference.begin(), at));
+      break;
+    case 1:
+    {
+      // Mostly short ranges, which often stay within one chunk, and now and
+      // then, while shrinking, one reaching far.
+      std::size_t length=random()%(size-at+1);
+      if (growing || random()%64!=0)
+        length%=random()%2==0 ? 8 : 40;
+      list.erase(list.begin()+at, list.begin()+(at+length));
+      reference.erase(std::next(reference.begin(), at), std::next(reference.begin(), at+length));
+      break;
+    }
+    case 2:
+      CHECK(list.popFirst()==reference.front());
+      reference.pop_front();
+      break;
+    default:
+      CHECK(list.popLast()==reference.back());
+      reference.pop_back();
+    }
+  }
+  checkEqual(list, reference);
+
+  list.erase(list.begin(), list.end());
+  reference.clear();
+  checkEqual(list, reference);
+}
+
+void rangeErrors()
+{
+  UnrolledList<int, 16> list;
+  for (int i=0;i<100;i++)
+    list.append(i);
+  bool thrown=false;
+  try
+  {
+    list.erase(list.begin()+50, list.begin()+10);
+  }
+  catch (std::out_of_range&)
+  {
+    thrown=true;
+  }
+  CHECK(thrown);
+  CHECK(list.getSize()==100);
+  thrown=false;
+  try
+  {
+    list.erase(list.begin()+2, list.begin()+1);
+  }
+  catch (std::out_of_range&)
+  {
+    thrown=true;
+  }
+  CHECK(thrown);
+  CHECK(list.getSize()==100);
+}
+
+}
+
+int main()
+{
+  auto number=[](unsigned x) { return static_cast<int>(x%1000); };
+  auto text=[](unsigned x) { return std::string(x%40, static_cast<char>('a'+x%26)); };
+  differential<int, 16>(1, number);
+  differential<int, 512>(2, number);
+  differential<std::string, 256>(3, text);
+  rangeErrors();
+  return 0;
+}
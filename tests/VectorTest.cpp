@@ -0,0 +1,444 @@
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SmallVector.h"
+#include "Vector.h"
+#include "Check.h"
+
+using namespace Linear;
+
+namespace
+{
+
+// Counts live objects, so that a missed or doubled destructor shows up.
+struct Counted
+{
+  static long live;
+  std::string value;
+
+  explicit Counted(std::string value) : value(std::move(value))
+  {
+    live++;
+  }
+
+  Counted(const Counted& other) : value(other.value)
+  {
+    live++;
+  }
+
+  Counted(Counted&& other) noexcept : value(std::move(other.value))
+  {
+    live++;
+  }
+
+  Counted& operator=(const Counted&) = default;
+  Counted& operator=(Counted&&) = default;
+
+  ~Counted()
+  {
+    live--;
+  }
+
+  bool operator==(const Counted& other) const
+  {
+    return value==other.value;
+  }
+};
+
+long Counted::live=0;
+
+template <typename Container, typename Type>
+void checkEqual(const Container& container, const std::vector<Type>& reference)
+{
+  CHECK(container.getSize()==reference.size());
+  CHECK(container.getCapacity()>=container.getSize());
+  CHECK(container.isEmpty()==reference.empty());
+  for (std::size_t i=0;i<reference.size();i++)
+    CHECK(container[i]==reference[i]);
+  CHECK(static_cast<std::size_t>(container.end()-container.begin())==reference.size());
+}
+
+// Applies the same random operations to a container and a std::vector.
+template <typename Container, typename Type, typename Make>
+void differential(unsigned seed, Make make)
+{
+  std::mt19937 random(seed);
+  Container container;
+  std::vector<Type> reference;
+  for (int step=0;step<20000;step++)
+  {
+    Type value=make(random());
+    std::size_t size=reference.size();
+    switch (random()%12)
+    {
+    case 0:
+    case 1:
+      container.append(value);
+      reference.push_back(value);
+      break;
+    case 2:
+      container.prepend(value);
+      reference.insert(reference.begin(), value);
+      break;
+    case 3:
+    {
+      std::size_t at=size==0 ? 0 : random()%(size+1);
+      container.insert(container.begin()+at, value);
+      reference.insert(reference.begin()+at, value);
+      break;
+    }
+    case 4:
+      if (size!=0)
+      {
+        std::size_t at=random()%size;
+        container.erase(container.begin()+at);
+        reference.erase(reference.begin()+at);
+      }
+      break;
+    case 5:
+      if (size!=0)
+      {
+        std::size_t first=random()%size;
+        std::size_t last=first+random()%(size-first+1);
+        container.erase(container.begin()+first, container.begin()+last);
+        reference.erase(reference.begin()+first, reference.begin()+last);
+      }
+      break;
+    case 6:
+      if (size!=0)
+      {
+        CHECK(container.popLast()==reference.back());
+        reference.pop_back();
+      }
+      break;
+    case 7:
+      if (size!=0)
+      {
+        CHECK(container.popFirst()==reference.front());
+        reference.erase(reference.begin());
+      }
+      break;
+    case 8:
+      container.shrink_to_fit();
+      break;
+    case 9:
+    {
+      Container copy(container);
+      Container moved(std::move(copy));
+      CHECK(copy.getSize()==0);
+      container=moved;
+      if (random()%2==0)
+        container=std::move(moved);
+      break;
+    }
+    case 10:
+      if (random()%20==0)
+      {
+        container.clear();
+        reference.clear();
+      }
+      else
+        container.reserve(size+random()%10);
+      break;
+    default:
+      CHECK(container.emplace_back(value)==value);
+      reference.push_back(value);
+    }
+    checkEqual(container, reference);
+  }
+}
+
+// Both containers are built from, and convertible to, any iterator range.
+void interoperation()
+{
+  Vector<int> vector{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  SmallVector<int, 4> small(vector.begin(), vector.end());
+  CHECK(!small.isSmall());
+  Vector<int> back(small.begin(), small.end());
+  CHECK(back.getSize()==vector.getSize());
+  for (std::size_t i=0;i<vector.getSize();i++)
+    CHECK(back[i]==vector[i]);
+
+  SmallVector<int, 4> few(vector.begin(), vector.begin()+3);
+  CHECK(few.isSmall());
+  few.append(4);
+  CHECK(few.isSmall());
+  few.append(5);
+  CHECK(!few.isSmall());
+  few.erase(few.begin()+1, few.end());
+  few.shrink_to_fit();
+  CHECK(few.isSmall() && few.getSize()==1 && few[0]==1);
+}
+
+// Counts how elements are made and relocated. Without a noexcept move,
+// growing must copy, so that a throwing copy leaves the old elements alone;
+// copies throw once failAfter reaches 0. There is no default constructor.
+template <bool NOEXCEPT_MOVE>
+struct Relocated
+{
+  static long live;
+  static long copies;
+  static long moves;
+  static long failAfter;
+  int value;
+
+  explicit Relocated(int value) : value(value)
+  {
+    live++;
+  }
+
+  Relocated(const Relocated& other) : value(other.value)
+  {
+    if (failAfter==0)
+      throw std::runtime_error("copy failed");
+    failAfter--;
+    copies++;
+    live++;
+  }
+
+  Relocated(Relocated&& other) noexcept(NOEXCEPT_MOVE) : value(other.value)
+  {
+    moves++;
+    live++;
+  }
+
+  Relocated& operator=(const Relocated& other)
+  {
+    value=other.value;
+    copies++;
+    return *this;
+  }
+
+  Relocated& operator=(Relocated&& other) noexcept(NOEXCEPT_MOVE)
+  {
+    value=other.value;
+    moves++;
+    return *this;
+  }
+
+  ~Relocated()
+  {
+    live--;
+  }
+
+  static void reset()
+  {
+    copies=0;
+    moves=0;
+    failAfter=-1;
+  }
+};
+
+template <bool NOEXCEPT_MOVE> long Relocated<NOEXCEPT_MOVE>::live=0;
+template <bool NOEXCEPT_MOVE> long Relocated<NOEXCEPT_MOVE>::copies=0;
+template <bool NOEXCEPT_MOVE> long Relocated<NOEXCEPT_MOVE>::moves=0;
+template <bool NOEXCEPT_MOVE> long Relocated<NOEXCEPT_MOVE>::failAfter=-1;
+
+// Capacity grows geometrically, so n appends relocate O(n) elements in
+// O(log n) steps; relocation moves when moving cannot throw and copies
+// otherwise; reserved storage holds no objects and emplace_back builds in
+// place.
+template <bool NOEXCEPT_MOVE>
+void growth()
+{
+  using Element = Relocated<NOEXCEPT_MOVE>;
+  const long N=1000;
+  {
+    Vector<Element> vector;
+    Element::reset();
+    std::size_t capacity=vector.getCapacity();
+    int reallocations=0;
+    for (long i=0;i<N;i++)
+    {
+      vector.append(Element(static_cast<int>(i)));
+      if (vector.getCapacity()!=capacity)
+      {
+        reallocations++;
+        capacity=vector.getCapacity();
+      }
+    }
+    CHECK(reallocations<=11 && Element::live==N);
+    if (NOEXCEPT_MOVE)
+      CHECK(Element::copies==0 && Element::moves<=3*N);
+    else
+      CHECK(Element::copies<=2*N && Element::moves==N);
+    for (long i=0;i<N;i++)
+      CHECK(vector[i].value==i);
+
+    Vector<Element> reserved;
+    reserved.reserve(100);
+    std::size_t room=reserved.getCapacity();
+    CHECK(room>=100 && reserved.isEmpty() && Element::live==N);
+    Element::reset();
+    for (int i=0;i<100;i++)
+      CHECK(reserved.emplace_back(i).value==i);
+    CHECK(Element::copies==0 && Element::moves==0 && reserved.getCapacity()==room);
+  }
+  CHECK(Element::live==0);
+
+  // Arguments may refer to elements of the vector being grown.
+  Vector<Element> vector;
+  for (int i=0;i<4;i++)
+    vector.emplace_back(i);
+  vector.shrink_to_fit();
+  CHECK(vector.getCapacity()==4);
+  vector.append(vector[0]);
+  vector.prepend(vector[4]);
+  vector.shrink_to_fit();
+  vector.emplace(vector.begin()+2, vector[5].value);
+  int expected[]={0, 0, 0, 1, 2, 3, 0};
+  CHECK(vector.getSize()==7);
+  for (std::size_t i=0;i<7;i++)
+    CHECK(vector[i].value==expected[i]);
+
+  // A copy failing while the storage grows leaves the vector as it was.
+  if (!NOEXCEPT_MOVE)
+  {
+    vector.shrink_to_fit();
+    Element::reset();
+    Element::failAfter=3;
+    bool thrown=false;
+    try
+    {
+      vector.append(Element(9));
+    }
+    catch (std::runtime_error&)
+    {
+      thrown=true;
+    }
+    Element::reset();
+    CHECK(thrown && vector.getSize()==7 && vector.getCapacity()==7);
+    for (std::size_t i=0;i<7;i++)
+      CHECK(vector[i].value==expected[i]);
+    CHECK(Element::live==7);
+  }
+}
+
+// Positions are taken from the iterator itself, not by searching for an
+// element, so they hold among equal elements; inserting or erasing at an
+// index only touches the elements behind it.
+void positions()
+{
+  std::vector<int> reference(100, 0);
+  Vector<int> zeros(reference.begin(), reference.end());
+  for (int i=1;i<=50;i++)
+  {
+    std::size_t at=static_cast<std::size_t>(i*37)%(reference.size()+1);
+    zeros.insert(zeros.begin()+at, i);
+    reference.insert(reference.begin()+at, i);
+    auto it=zeros.emplace(zeros.cbegin()+at/2, -i);
+    reference.insert(reference.begin()+at/2, -i);
+    CHECK(it==zeros.begin()+at/2 && *it==-i);
+  }
+  checkEqual(zeros, reference);
+  for (int i=0;i<40;i++)
+  {
+    std::size_t at=static_cast<std::size_t>(i*53)%reference.size();
+    zeros.erase(zeros.cbegin()+at);
+    reference.erase(reference.begin()+at);
+  }
+  checkEqual(zeros, reference);
+
+  using Element = Relocated<true>;
+  Vector<Element> vector;
+  vector.reserve(2000);
+  for (int i=0;i<1000;i++)
+    vector.emplace_back(i);
+  Element::reset();
+  // Ten elements shift, and the new one is moved twice on its way in.
+  vector.insert(vector.begin()+990, Element(-1));
+  CHECK(Element::moves==12 && Element::copies==0);
+  Element::reset();
+  vector.erase(vector.begin()+980, vector.begin()+985);
+  CHECK(Element::moves==16 && Element::copies==0);
+  Element::reset();
+  vector.erase(vector.end()-1);
+  vector.emplace(vector.end(), 5);
+  vector.append(Element(6));
+  CHECK(Element::moves==1 && Element::copies==0 && vector.getSize()==997);
+  CHECK(vector[984].value==989 && vector[985].value==-1 && vector[995].value==5);
+}
+
+template <typename Operation>
+bool throwsOutOfRange(Operation operation)
+{
+  try
+  {
+    operation();
+  }
+  catch (std::out_of_range&)
+  {
+    return true;
+  }
+  return false;
+}
+
+// at() is always checked. With LINEAR_CHECKED_ITERATORS, operator[] and
+// iterators are checked as well, also once the vector has shrunk under
+// them; without it, iterators are plain pointers in size.
+void checkedAccess()
+{
+  Vector<int> vector{0, 1, 2, 3, 4, 5, 6, 7};
+  const Vector<int>& constVector=vector;
+  CHECK(vector.at(7)==7 && constVector.at(0)==0);
+  CHECK(throwsOutOfRange([&] { vector.at(8); }));
+  CHECK(throwsOutOfRange([&] { constVector.at(static_cast<std::size_t>(-1)); }));
+  CHECK(throwsOutOfRange([&] { vector.erase(vector.begin()+3, vector.begin()+2); }));
+  CHECK(vector.getSize()==8);
+#if LINEAR_CHECKED_ITERATORS
+  CHECK(throwsOutOfRange([&] { vector[8]; }));
+  CHECK(throwsOutOfRange([&] { constVector[100]; }));
+  CHECK(throwsOutOfRange([&] { *vector.end(); }));
+  CHECK(throwsOutOfRange([&] { ++vector.end(); }));
+  CHECK(throwsOutOfRange([&] { --vector.begin(); }));
+  CHECK(throwsOutOfRange([&] { vector.begin()+9; }));
+  CHECK(throwsOutOfRange([&] { vector.cbegin()[8]; }));
+  auto sixth=vector.begin()+5;
+  auto last=vector.end()-1;
+  vector.erase(vector.begin(), vector.begin()+2);
+  CHECK(*sixth==7);
+  CHECK(throwsOutOfRange([&] { *last; }));
+  vector.popLast();
+  CHECK(throwsOutOfRange([&] { *sixth; }));
+  vector.clear();
+  CHECK(throwsOutOfRange([&] { *vector.begin(); }));
+  // Positions in another vector are rejected before anything changes.
+  Vector<int> other{1, 2, 3};
+  CHECK(throwsOutOfRange([&] { vector.insert(other.begin(), 9); }));
+  CHECK(throwsOutOfRange([&] { other.erase(vector.begin()); }));
+  CHECK(vector.isEmpty() && other.getSize()==3);
+#else
+  CHECK(sizeof(Vector<int>::iterator)==sizeof(int*));
+  CHECK(sizeof(Vector<int>::const_iterator)==sizeof(int*));
+#endif
+}
+
+}
+
+int main()
+{
+  auto number=[](unsigned x) { return static_cast<int>(x); };
+  // Some strings longer than the inline buffer of std::string.
+  auto text=[](unsigned x) { return std::string(x%3==0 ? 40 : 3, static_cast<char>('a'+x%26)); };
+  auto counted=[&](unsigned x) { return Counted(text(x)); };
+  for (unsigned seed=0;seed<2;seed++)
+  {
+    differential<Vector<int>, int>(seed, number);
+    differential<Vector<std::string>, std::string>(seed, text);
+    differential<SmallVector<int, 4>, int>(seed, number);
+    differential<SmallVector<std::string, 3>, std::string>(seed, text);
+    differential<SmallVector<Counted, 8>, Counted>(seed, counted);
+    differential<Vector<Counted>, Counted>(seed, counted);
+  }
+  CHECK(Counted::live==0);
+  interoperation();
+  growth<true>();
+  growth<false>();
+  positions();
+  checkedAccess();
+  return 0;
+}